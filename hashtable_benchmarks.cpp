@@ -0,0 +1,356 @@
+/*
+ *  Throughput benchmarks (Google Benchmark) for one HashTable header, or for std::unordered_set as the baseline. Each
+ *  header defines its own HashTable so the header is picked at compile time: -DHASHTABLE_HEADER='"hashtable_swiss.h"',
+ *  or nothing for std::unordered_set. `make bench` builds every variant and writes each one's results to
+ *  bench_<name>.json, BENCH_ARGS passes flags through (e.g. BENCH_ARGS=--benchmark_filter=/int/).
+ *
+ *  operations  - insert, contains_hit, contains_miss, remove, churn (remove a key, insert another), rehash
+ *  key types   - int, uint64, short_string (8 chars, inline in std::string), long_string (40 chars sharing a 32 char
+ *                prefix, on the heap)
+ *  sizes       - key counts whose table fills half of L1, L2 and the last level cache, and 10x the last level cache,
+ *                from the cache sizes of the machine running them
+ *  load factors - every max load factor the table accepts out of .25, .5, .75 and 1, or its fixed one
+ *
+ *  Benchmarks are named <table>/<operation>/<key type>/<size>/lf:<max load factor>, items_per_second is the number
+ *  to compare.
+*/
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#ifdef HASHTABLE_HEADER
+#include HASHTABLE_HEADER
+
+template <class Key>
+using Table = HashTable<Key>;
+
+std::string table_name() {
+    std::string header = HASHTABLE_HEADER; // hashtable_<name>.h
+    return header.substr(10, header.size() - 12);
+}
+#else
+// std::unordered_set behind the interface the HashTable headers share
+template <class Key>
+class Table {
+    private:
+        std::unordered_set<Key> set;
+
+    public:
+        Table() : set{} {}
+        bool insert(const Key& value) { return set.insert(value).second; }
+        size_t remove(const Key& value) { return set.erase(value); }
+        bool contains(const Key& value) const { return set.count(value) != 0; }
+        size_t size() const { return set.size(); }
+        float load_factor() const { return set.load_factor(); }
+        void max_load_factor(float max) { set.max_load_factor(max); }
+        void rehash(size_t num_buckets) { set.rehash(num_buckets); }
+};
+
+std::string table_name() { return "std_unordered_set"; }
+#endif
+
+// not every table has a configurable load factor or a public rehash (hashtable_swiss.h has neither). hashtable_open_addressing.h
+// keeps rehash to itself, but reserve() and shrink_to_fit() each do exactly one
+template <class T, class = void>
+struct has_max_load_factor : std::false_type {};
+template <class T>
+struct has_max_load_factor<T, std::void_t<decltype(std::declval<T&>().max_load_factor(1.0f))>> : std::true_type {};
+
+template <class T, class = void>
+struct has_rehash : std::false_type {};
+template <class T>
+struct has_rehash<T, std::void_t<decltype(std::declval<T&>().rehash(size_t{})), decltype(std::declval<const T&>().load_factor())>>
+    : std::true_type {};
+
+template <class T, class = void>
+struct has_reserve : std::false_type {};
+template <class T>
+struct has_reserve<T, std::void_t<decltype(std::declval<T&>().reserve(size_t{})), decltype(std::declval<T&>().shrink_to_fit()),
+                                  decltype(std::declval<const T&>().load_factor())>> : std::true_type {};
+
+// bijective mixes, so distinct counters always make distinct keys
+uint32_t mix32(uint32_t x) {
+    x ^= x >> 16; x *= 0x7feb352d;
+    x ^= x >> 15; x *= 0x846ca68b;
+    return x ^ (x >> 16);
+}
+
+uint64_t mix64(uint64_t x) {
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9;
+    x ^= x >> 27; x *= 0x94d049bb133111eb;
+    return x ^ (x >> 31);
+}
+
+std::string hex(uint32_t x) {
+    char digits[9];
+    std::snprintf(digits, sizeof(digits), "%08x", x);
+    return digits;
+}
+
+// key types. bytes is what one key costs, counting any heap block it owns
+struct IntKeys {
+    using type = int;
+    static constexpr const char* name = "int";
+    static constexpr size_t bytes = sizeof(int);
+    static int make(uint64_t i) { return static_cast<int>(mix32(static_cast<uint32_t>(i))); }
+};
+
+struct Uint64Keys {
+    using type = uint64_t;
+    static constexpr const char* name = "uint64";
+    static constexpr size_t bytes = sizeof(uint64_t);
+    static uint64_t make(uint64_t i) { return mix64(i); }
+};
+
+struct ShortStringKeys {
+    using type = std::string;
+    static constexpr const char* name = "short_string";
+    static constexpr size_t bytes = sizeof(std::string);
+    static std::string make(uint64_t i) { return hex(mix32(static_cast<uint32_t>(i))); }
+};
+
+struct LongStringKeys {
+    using type = std::string;
+    static constexpr const char* name = "long_string";
+    static constexpr size_t bytes = sizeof(std::string) + 48;
+    static std::string make(uint64_t i) { return "benchmarks/hashtable/long/keys/" + hex(mix32(static_cast<uint32_t>(i))); }
+};
+
+// the first count keys of Kind, made once and shared by every benchmark. a table of count keys holds the first count,
+// the next count are its misses
+template <class Kind>
+const std::vector<typename Kind::type>& keys(size_t count) {
+    static std::vector<typename Kind::type> pool;
+    while (pool.size() < count) pool.push_back(Kind::make(pool.size()));
+    return pool;
+}
+
+// max load factor 0 leaves the table's default
+template <class Key>
+void configure(Table<Key>& table, float max_load_factor) {
+    if constexpr (has_max_load_factor<Table<Key>>::value) {
+        if (max_load_factor > 0) table.max_load_factor(max_load_factor);
+    }
+}
+
+template <class Key>
+void fill(Table<Key>& table, const std::vector<Key>& pool, size_t count) {
+    for (size_t i = 0; i < count; i++) table.insert(pool[i]);
+}
+
+// counters saying what was measured. call with the table full
+template <class Key>
+void describe(benchmark::State& state, const Table<Key>& table, size_t count) {
+    state.counters["keys"] = static_cast<double>(count);
+    if constexpr (has_rehash<Table<Key>>::value || has_reserve<Table<Key>>::value) state.counters["load_factor"] = table.load_factor();
+}
+
+void processed(benchmark::State& state, size_t operations) {
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * operations));
+}
+
+// operations
+template <class Kind>
+void bench_insert(benchmark::State& state, size_t count, float max_load_factor) {
+    using Key = typename Kind::type;
+    const std::vector<Key>& pool = keys<Kind>(count);
+    auto table = std::make_unique<Table<Key>>();
+    for (auto _ : state) {
+        state.PauseTiming();
+        table = std::make_unique<Table<Key>>();
+        configure(*table, max_load_factor);
+        state.ResumeTiming();
+        for (size_t i = 0; i < count; i++) benchmark::DoNotOptimize(table->insert(pool[i]));
+    }
+    describe(state, *table, count);
+    processed(state, count);
+}
+
+template <class Kind>
+void bench_contains_hit(benchmark::State& state, size_t count, float max_load_factor) {
+    using Key = typename Kind::type;
+    const std::vector<Key>& pool = keys<Kind>(count);
+    Table<Key> table;
+    configure(table, max_load_factor);
+    fill(table, pool, count);
+    describe(state, table, count);
+    for (auto _ : state) {
+        for (size_t i = 0; i < count; i++) benchmark::DoNotOptimize(table.contains(pool[i]));
+    }
+    processed(state, count);
+}
+
+template <class Kind>
+void bench_contains_miss(benchmark::State& state, size_t count, float max_load_factor) {
+    using Key = typename Kind::type;
+    const std::vector<Key>& pool = keys<Kind>(2 * count);
+    Table<Key> table;
+    configure(table, max_load_factor);
+    fill(table, pool, count);
+    describe(state, table, count);
+    for (auto _ : state) {
+        for (size_t i = count; i < 2 * count; i++) benchmark::DoNotOptimize(table.contains(pool[i]));
+    }
+    processed(state, count);
+}
+
+template <class Kind>
+void bench_remove(benchmark::State& state, size_t count, float max_load_factor) {
+    using Key = typename Kind::type;
+    const std::vector<Key>& pool = keys<Kind>(count);
+    Table<Key> table;
+    configure(table, max_load_factor);
+    fill(table, pool, count);
+    describe(state, table, count);
+    for (auto _ : state) {
+        for (size_t i = 0; i < count; i++) benchmark::DoNotOptimize(table.remove(pool[i]));
+        state.PauseTiming();
+        fill(table, pool, count);
+        state.ResumeTiming();
+    }
+    processed(state, count);
+}
+
+// the table stays at count keys: each iteration swaps every key for one of the other count, and the next swaps back
+template <class Kind>
+void bench_churn(benchmark::State& state, size_t count, float max_load_factor) {
+    using Key = typename Kind::type;
+    const std::vector<Key>& pool = keys<Kind>(2 * count);
+    Table<Key> table;
+    configure(table, max_load_factor);
+    fill(table, pool, count);
+    describe(state, table, count);
+    size_t in = 0;
+    for (auto _ : state) {
+        size_t out = count - in;
+        for (size_t i = 0; i < count; i++) {
+            benchmark::DoNotOptimize(table.remove(pool[in + i]));
+            benchmark::DoNotOptimize(table.insert(pool[out + i]));
+        }
+        in = out;
+    }
+    processed(state, 2 * count);
+}
+
+// alternates between twice and four times the size the table grew to, so every iteration moves every key. tables
+// without a public rehash alternate reserve() for four times the keys with shrink_to_fit(), one rehash each
+template <class Kind>
+void bench_rehash(benchmark::State& state, size_t count, float max_load_factor) {
+    using Key = typename Kind::type;
+    const std::vector<Key>& pool = keys<Kind>(count);
+    Table<Key> table;
+    configure(table, max_load_factor);
+    fill(table, pool, count);
+    describe(state, table, count);
+    size_t size = static_cast<size_t>(count / table.load_factor());
+    bool larger = false;
+    for (auto _ : state) {
+        larger = !larger;
+        if constexpr (has_rehash<Table<Key>>::value) {
+            table.rehash(larger ? 4 * size : 2 * size);
+        } else if (larger) {
+            table.reserve(4 * count);
+        } else {
+            table.shrink_to_fit();
+        }
+    }
+    processed(state, count);
+}
+
+// registration
+struct Size {
+    const char* name;
+    size_t keys;
+};
+
+// cache sizes as {L1 data, L2, last level}, or typical ones if the library can't read them
+std::vector<size_t> cache_sizes() {
+    size_t l1 = 32 << 10, l2 = 1 << 20, last = 32 << 20;
+    int last_level = 0;
+    for (const auto& cache : benchmark::CPUInfo::Get().caches) {
+        if (cache.type == "Instruction" || cache.size <= 0) continue;
+        size_t bytes = static_cast<size_t>(cache.size);
+        if (cache.level == 1) l1 = bytes;
+        if (cache.level == 2) l2 = bytes;
+        if (cache.level >= last_level) {
+            last_level = cache.level;
+            last = bytes;
+        }
+    }
+    return {l1, l2, last};
+}
+
+// a table's footprint is taken as 2 * sizeof(key) + 16 bytes a key (a slot at half load plus bookkeeping), plus any
+// heap the key owns
+template <class Kind>
+std::vector<Size> sizes() {
+    size_t key_bytes = 2 * sizeof(typename Kind::type) + 16 + (Kind::bytes - sizeof(typename Kind::type));
+    std::vector<size_t> caches = cache_sizes();
+    auto keys_in = [key_bytes](size_t bytes) { return std::max<size_t>(64, bytes / key_bytes); };
+    return {{"L1", keys_in(caches[0] / 2)}, {"L2", keys_in(caches[1] / 2)}, {"LLC", keys_in(caches[2] / 2)},
+            {"10xLLC", keys_in(10 * caches[2])}};
+}
+
+template <class Key>
+std::vector<float> load_factors() {
+    if constexpr (!has_max_load_factor<Table<Key>>::value) {
+        return {0};
+    } else {
+        std::vector<float> accepted;
+        for (float max_load_factor : {0.25f, 0.5f, 0.75f, 1.0f}) {
+            Table<Key> table;
+            try {
+                table.max_load_factor(max_load_factor);
+                accepted.push_back(max_load_factor);
+            } catch (const std::invalid_argument&) {}
+        }
+        return accepted;
+    }
+}
+
+template <class Kind>
+void register_key_type() {
+    using Benchmark = void (*)(benchmark::State&, size_t, float);
+    std::vector<std::pair<const char*, Benchmark>> operations = {
+        {"insert", bench_insert<Kind>}, {"contains_hit", bench_contains_hit<Kind>},
+        {"contains_miss", bench_contains_miss<Kind>}, {"remove", bench_remove<Kind>}, {"churn", bench_churn<Kind>}};
+    if constexpr (has_rehash<Table<typename Kind::type>>::value || has_reserve<Table<typename Kind::type>>::value)
+        operations.emplace_back("rehash", bench_rehash<Kind>);
+
+    for (const auto& [operation, run] : operations) {
+        for (const Size& size : sizes<Kind>()) {
+            for (float max_load_factor : load_factors<typename Kind::type>()) {
+                char load[16] = "default";
+                if (max_load_factor > 0) std::snprintf(load, sizeof(load), "%.2f", max_load_factor);
+                std::string name = table_name() + "/" + operation + "/" + Kind::name + "/" + size.name + "/lf:" + load;
+                size_t count = size.keys;
+                Benchmark body = run;
+                benchmark::RegisterBenchmark(name.c_str(), [=](benchmark::State& state) { body(state, count, max_load_factor); })
+                    ->Unit(benchmark::kMicrosecond);
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+
+    register_key_type<IntKeys>();
+    register_key_type<Uint64Keys>();
+    register_key_type<ShortStringKeys>();
+    register_key_type<LongStringKeys>();
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,105 @@
+/*
+ *  Thread safe hashtable for many readers and writers. Keys are striped across a power of two number of shards, each
+ *  an ordinary HashTable behind its own reader/writer lock, so threads only contend when they touch the same shard and
+ *  lookups on a shard run in parallel. The shard is picked from the high bits of the mixed hash, the shard's own table
+ *  uses the low bits.
+ *  Not standalone: include one of hashtable_open_addressing.h, hashtable_separate_chaining.h or hashtable_swiss.h
+ *  first, its HashTable is the shard type.
+*/
+
+#pragma once
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+#include "hashtable_policies.h"
+
+template <class Key, class Hash=std::hash<Key>, class KeyEqual=std::equal_to<Key>, class Table=HashTable<Key, Hash, KeyEqual>>
+class ConcurrentHashTable {
+
+    private:
+        // one cache line (or more) per shard so locking one shard doesn't invalidate its neighbours
+        struct alignas(64) Shard {
+            mutable std::shared_mutex mutex;
+            Table table;
+            Shard() : mutex{}, table{} {}
+        };
+
+        std::unique_ptr<Shard[]> shards;
+        size_t shard_mask;
+        unsigned shard_shift; // drops all but the top log2(shard count) bits of the mixed hash
+
+        // 4 shards per hardware thread keeps the chance of two threads wanting the same shard low
+        static size_t default_shard_count() {
+            size_t threads = std::thread::hardware_concurrency();
+            return (threads ? threads : 8) * 4;
+        }
+
+        Shard& shard_for(const Key& key) const {
+            size_t hash_value = PowerOfTwoSizing::mix(Hash{}(key));
+            return shards[shard_mask ? (hash_value >> shard_shift) & shard_mask : 0];
+        }
+
+    public:
+        // constructors
+        ConcurrentHashTable() : ConcurrentHashTable(default_shard_count()) {}
+        explicit ConcurrentHashTable(size_t shard_count) : shards{}, shard_mask{0}, shard_shift{0} {
+            shard_count = PowerOfTwoSizing::valid_size(shard_count);
+            shards = std::make_unique<Shard[]>(shard_count);
+            shard_mask = shard_count - 1;
+            unsigned bits = 0;
+            while ((size_t{1} << bits) < shard_count) bits++;
+            shard_shift = static_cast<unsigned>(sizeof(size_t) * 8) - bits;
+        }
+
+        ConcurrentHashTable(const ConcurrentHashTable&) = delete;
+        ConcurrentHashTable& operator=(const ConcurrentHashTable&) = delete;
+
+        // capacity. size() takes every shard's lock (shared, always in shard order) before reading any count, so it is
+        // the exact size at one instant even while other threads insert and remove. O(shard count)
+        size_t size() const {
+            std::vector<std::shared_lock<std::shared_mutex>> locks;
+            locks.reserve(shard_mask + 1);
+            size_t total = 0;
+            for (size_t i = 0; i <= shard_mask; i++) locks.emplace_back(shards[i].mutex);
+            for (size_t i = 0; i <= shard_mask; i++) total += shards[i].table.size();
+            return total;
+        }
+        bool is_empty() const { return size() == 0; }
+        size_t shard_count() const { return shard_mask + 1; }
+
+        // modifiers
+        bool insert(const Key& value) { // returns true on successful insert, false on failed insert
+            Shard& shard = shard_for(value);
+            std::unique_lock lock(shard.mutex);
+            return shard.table.insert(value);
+        }
+        bool insert(Key&& value) {
+            Shard& shard = shard_for(value);
+            std::unique_lock lock(shard.mutex);
+            return shard.table.insert(std::move(value));
+        }
+
+        size_t remove(const Key& value) { // returns 1 on successful removal, 0 on failed removal
+            Shard& shard = shard_for(value);
+            std::unique_lock lock(shard.mutex);
+            return shard.table.remove(value);
+        }
+
+        // empties each shard in turn. keys inserted by other threads meanwhile may survive
+        void make_empty() {
+            for (size_t i = 0; i <= shard_mask; i++) {
+                std::unique_lock lock(shards[i].mutex);
+                shards[i].table.make_empty();
+            }
+        }
+
+        // lookup
+        bool contains(const Key& value) const {
+            Shard& shard = shard_for(value);
+            std::shared_lock lock(shard.mutex);
+            return shard.table.contains(value);
+        }
+};
@@ -0,0 +1,173 @@
+#include "hashtable_open_addressing.h"
+#include "hashtable_concurrent.h"
+#include <thread>
+#include <atomic>
+#include <iostream>
+
+#define black   "\033[30m"
+#define red     "\033[31m"
+#define green   "\033[32m"
+#define yellow  "\033[33m"
+#define blue    "\033[34m"
+#define magenta "\033[35m"
+#define cyan    "\033[36m"
+#define white   "\033[37m"
+#define reset   "\033[m"
+
+#define to_be ==
+#define not_to_be !=
+#define is to_be
+#define is_not not_to_be
+
+#define expect(X) try {\
+  if (!(X)) {\
+    std::cout << red "  [fail]" reset " (" << __FILE__ << ":" << __FUNCTION__ << ":" << __LINE__ << ") " << red << "expected " << #X << "." << reset << std::endl;\
+  }\
+} catch(...) {\
+  std::cout << red "  [fail]" reset " (" << __FILE__ << ":" << __FUNCTION__ << ":" << __LINE__ << ") " << red << #X << " threw an unexpected exception." << reset << std::endl;\
+}
+
+#define assert(X) try {\
+  if (!(X)) {\
+    std::cout << red "  [fail]" reset " (" << __FILE__ << ":" << __FUNCTION__ << ":" << __LINE__ << ") " << red << "failed assertion that " << #X << "." << reset << std::endl;\
+    std::abort();\
+  }\
+} catch(...) {\
+  std::cout << red "  [fail]" reset " (" << __FILE__ << ":" << __FUNCTION__ << ":" << __LINE__ << ") " << red << #X << " assertion threw an unexpected exception." << reset << std::endl;\
+}
+
+#define expect_throw(X,E) {\
+  bool threw_expected_exception = false;\
+  try { X; }\
+  catch(const E& err) {\
+    threw_expected_exception = true;\
+  } catch(...) {\
+    std::cout << blue << "  [help] " << #X << " threw an incorrect exception." << reset << std::endl;\
+  }\
+  if (!threw_expected_exception) {\
+    std::cout << red <<"  [fail]" << reset << " (" << __FILE__ << ":" << __FUNCTION__ << ":" << __LINE__ << ") " << red << "expected " << #X << " to throw " << #E <<"." << reset <<std::endl;\
+  }\
+}
+
+#define expect_no_throw(X) {\
+  try { X; }\
+  catch(...) {\
+    std::cout << red << "  [fail]" << red << " (" << __FILE__ << ":" << __FUNCTION__ << ":" << __LINE__ << ") " << red << "expected " << #X << " not to throw an excpetion." << reset << std::endl;\
+  }\
+}
+
+// runs body(t) on threads 0 to count - 1 and waits for all of them
+template <class Body>
+void run_threads(size_t count, Body body) {
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < count; t++) threads.emplace_back(body, t);
+    for (std::thread& thread : threads) thread.join();
+}
+
+int main() {
+    // constructors
+    {
+        ConcurrentHashTable<int> intTable;
+        expect(intTable.is_empty() to_be true);
+        expect(intTable.size() to_be 0);
+        expect((intTable.shard_count() >= 4) to_be true);
+
+        ConcurrentHashTable<int> shardedTable(6); // rounded up to a power of two
+        expect(shardedTable.shard_count() to_be 8);
+
+        ConcurrentHashTable<std::string> singleShard(1);
+        expect(singleShard.shard_count() to_be 1);
+        expect(singleShard.insert("a") to_be true);
+        expect(singleShard.contains("a") to_be true);
+    }
+
+    // insert / remove / contains
+    {
+        ConcurrentHashTable<int> intTable(16);
+        expect(intTable.insert(1) to_be true);
+        expect(intTable.insert(1) to_be false);
+        expect(intTable.contains(1) to_be true);
+        expect(intTable.contains(2) to_be false);
+        expect(intTable.size() to_be 1);
+        expect(intTable.remove(1) to_be 1);
+        expect(intTable.remove(1) to_be 0);
+        expect(intTable.is_empty() to_be true);
+
+        for (int i = 0; i < 1000; i++) intTable.insert(i);
+        expect(intTable.size() to_be 1000);
+        intTable.make_empty();
+        expect(intTable.size() to_be 0);
+        expect(intTable.contains(5) to_be false);
+
+        ConcurrentHashTable<std::string> stringTable(4);
+        std::string moved = "moved";
+        expect(stringTable.insert(std::move(moved)) to_be true);
+        expect(stringTable.contains("moved") to_be true);
+    }
+
+    // concurrent inserts of disjoint ranges
+    {
+        ConcurrentHashTable<int> intTable(32);
+        run_threads(8, [&](size_t t) {
+            for (int i = 0; i < 10000; i++) intTable.insert(static_cast<int>(t) * 10000 + i);
+        });
+        expect(intTable.size() to_be 80000);
+        for (int i = 0; i < 80000; i++) assert(intTable.contains(i) to_be true);
+    }
+
+    // concurrent inserts of the same keys only succeed once per key
+    {
+        ConcurrentHashTable<int> intTable(8);
+        std::atomic<int> inserted{0};
+        run_threads(8, [&](size_t) {
+            for (int i = 0; i < 5000; i++)
+                if (intTable.insert(i)) inserted++;
+        });
+        expect(inserted.load() to_be 5000);
+        expect(intTable.size() to_be 5000);
+    }
+
+    // readers alongside writers
+    {
+        ConcurrentHashTable<int> intTable(16);
+        for (int i = 0; i < 10000; i++) intTable.insert(i * 2); // evens stay put for the whole test
+        std::atomic<bool> missing{false};
+        run_threads(8, [&](size_t t) {
+            if (t < 2) { // writers churn odd keys
+                for (int round = 0; round < 5; round++) {
+                    for (int i = 0; i < 10000; i++) intTable.insert(i * 2 + 1);
+                    for (int i = 0; i < 10000; i++) intTable.remove(i * 2 + 1);
+                }
+            } else {
+                for (int i = 0; i < 50000; i++)
+                    if (!intTable.contains((i % 10000) * 2)) missing = true;
+            }
+        });
+        expect(missing.load() to_be false);
+        expect(intTable.size() to_be 10000);
+    }
+
+    // size is consistent while other threads move keys between shards
+    {
+        ConcurrentHashTable<int> intTable(16);
+        for (int i = 0; i < 1000; i++) intTable.insert(i);
+        std::atomic<bool> stop{false};
+        std::atomic<bool> inconsistent{false};
+        run_threads(3, [&](size_t t) {
+            if (t == 0) {
+                for (int i = 0; i < 200; i++)
+                    if (intTable.size() < 998 || intTable.size() > 1000) inconsistent = true;
+                stop = true;
+            } else { // each writer keeps at most one key out of the table at a time
+                for (int i = static_cast<int>(t); !stop; i = (i + 2) % 1000) {
+                    intTable.remove(i);
+                    intTable.insert(i);
+                }
+            }
+        });
+        expect(inconsistent.load() to_be false);
+        expect(intTable.size() to_be 1000);
+    }
+
+    return 0;
+}
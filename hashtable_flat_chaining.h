@@ -0,0 +1,251 @@
+/*
+ *  Separate chaining hashtable with flattened buckets. Each bucket is a cache line holding as many keys as fit inline
+ *  plus a count and the index of an overflow block, so a lookup in a bucket that hasn't overflowed reads one cache
+ *  line and follows no pointers. Overflow blocks are the same shape and come from a pool owned by the table.
+ *  Keys are kept packed: a remove moves the last key of the bucket into the hole.
+ *  Max load factor defaults to half a bucket's inline capacity (at least 1), so most buckets never overflow.
+ *  Same bucket interface (bucket_count, bucket_size, bucket, load factor, rehash) as hashtable_separate_chaining.h.
+*/
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <iostream> // for print_table only
+#include "hashtable_policies.h"
+
+using std::vector, std::cout, std::endl;
+
+template <class Key, class Hash=std::hash<Key>, class KeyEqual=std::equal_to<Key>, class Sizing=PrimeModuloSizing,
+          class Allocator=std::allocator<Key>>
+class HashTable {
+
+    public:
+        // keys held inline by each bucket or overflow block, as many as fit in a cache line beside the bookkeeping
+        static constexpr size_t bucket_capacity =
+            sizeof(Key) + 2 * sizeof(uint32_t) >= 64 ? 1 : (64 - 2 * sizeof(uint32_t)) / sizeof(Key);
+
+    private:
+        using Index = uint32_t;
+        static constexpr Index npos = std::numeric_limits<Index>::max(); // no overflow block
+
+        struct alignas(64) Block {
+            Key keys[bucket_capacity];
+            Index count;    // keys in use, always keys[0, count)
+            Index overflow; // next block of the bucket, or the next free block in the pool
+            Block() : keys{}, count{0}, overflow{npos} {}
+        };
+
+        vector<Block, rebind_alloc_t<Allocator, Block>> table;     // the first block of each bucket
+        vector<Block, rebind_alloc_t<Allocator, Block>> overflows; // every overflow block, chained by index
+        Index free_overflow;                                       // unused overflow blocks
+        size_t _size;
+        float _max_load_factor;
+
+        // maps hashes to buckets, kept in sync with table.size() through resize()
+        Sizing sizing;
+
+        // block after block in its bucket, nullptr at the end
+        Block* next_block(const Block& block) { return block.overflow == npos ? nullptr : &overflows[block.overflow]; }
+        const Block* next_block(const Block& block) const { return block.overflow == npos ? nullptr : &overflows[block.overflow]; }
+
+        // {block, slot} holding value in bucket index, or a null block if there is none
+        std::pair<const Block*, size_t> find_in_bucket(const Key& value, size_t index) const {
+            for (const Block* block = &table[index]; block; block = next_block(*block)) {
+                for (size_t i = 0; i < block->count; i++)
+                    if (KeyEqual{}(block->keys[i], value)) return {block, i};
+            }
+            return {nullptr, 0};
+        }
+
+        Index allocate_overflow() {
+            if (free_overflow != npos) {
+                Index block = free_overflow;
+                free_overflow = overflows[block].overflow;
+                overflows[block].overflow = npos;
+                return block;
+            }
+            if (overflows.size() == npos) throw std::length_error("flat chaining table overflow pool is full");
+            overflows.emplace_back();
+            return static_cast<Index>(overflows.size() - 1);
+        }
+
+        // appends a key known not to be in the table to the last block of its bucket, chaining on a new overflow block
+        // if that one is full
+        template <class K>
+        void place(K&& value, size_t index) {
+            Block* block = &table[index];
+            while (block->count == bucket_capacity && block->overflow != npos) block = &overflows[block->overflow];
+            if (block->count == bucket_capacity) {
+                bool in_pool = block != &table[index];
+                size_t position = in_pool ? static_cast<size_t>(block - overflows.data()) : 0;
+                Index added = allocate_overflow(); // may move the overflow blocks
+                block = in_pool ? &overflows[position] : &table[index];
+                block->overflow = added;
+                block = &overflows[added];
+            }
+            block->keys[block->count++] = std::forward<K>(value);
+        }
+
+        template <class K>
+        bool insert_value(K&& value) {
+            size_t hash_value = Hash{}(value);
+            if (find_in_bucket(value, sizing.index(hash_value)).first) return false;
+
+            // rehash check
+            if (static_cast<float>(_size + 1) / table.size() > _max_load_factor)
+                rehash(Sizing::next_size(table.size()));
+
+            // perform insert
+            place(std::forward<K>(value), sizing.index(hash_value));
+            _size++;
+            return true;
+        }
+
+    public:
+        // constructors
+        HashTable() : HashTable(11) {}
+        explicit HashTable(size_t size, const Allocator& allocator = Allocator())
+            : table(Sizing::valid_size(size), rebind_alloc_t<Allocator, Block>(allocator)), overflows(rebind_alloc_t<Allocator, Block>(allocator)),
+              free_overflow{npos}, _size{0}, _max_load_factor{std::max(1.0f, bucket_capacity / 2.0f)}, sizing{} {
+            sizing.resize(table.size());
+        }
+
+        Allocator get_allocator() const { return Allocator(table.get_allocator()); }
+
+        // capacity
+        bool is_empty() const { return _size == 0; }
+        size_t size() const { return _size; }
+
+        // modifiers
+        void make_empty() {
+            table.assign(table.size(), Block{});
+            overflows.clear();
+            free_overflow = npos;
+            _size = 0;
+        }
+
+        bool insert(const Key& value) { return insert_value(value); } // returns true on successful insert, false on failed insert
+        bool insert(Key&& value) { return insert_value(std::move(value)); }
+
+        size_t remove(const Key& value) { // returns 1 on successful removal, 0 on failed removal
+            size_t index = sizing.index(Hash{}(value));
+            auto [found, slot] = find_in_bucket(value, index);
+            if (!found) return 0;
+
+            // fill the hole with the bucket's last key, then drop the last block if that emptied it
+            Block* hole = const_cast<Block*>(found);
+            Block* previous = nullptr;
+            Block* last = &table[index];
+            while (last->overflow != npos) {
+                previous = last;
+                last = &overflows[last->overflow];
+            }
+            Key& moved = last->keys[last->count - 1];
+            if (&moved != &hole->keys[slot]) hole->keys[slot] = std::move(moved);
+            moved = Key{}; // so the unused slot doesn't keep what it held alive
+            last->count--;
+            if (last->count == 0 && previous) {
+                Index block = previous->overflow;
+                previous->overflow = npos;
+                overflows[block].overflow = free_overflow;
+                free_overflow = block;
+            }
+            _size--;
+
+            return 1;
+        }
+
+        // lookup
+        bool contains(const Key& value) const {
+            return find_in_bucket(value, sizing.index(Hash{}(value))).first != nullptr;
+        }
+
+        // bucket interface
+        size_t bucket_count() const { return table.size(); }
+        size_t bucket_size(size_t index) const {
+            if (index >= table.size()) throw std::out_of_range("specified bucket is out of bounds");
+
+            size_t count = 0;
+            for (const Block* block = &table[index]; block; block = next_block(*block)) count += block->count;
+            return count;
+        }
+        size_t bucket(const Key& value) const { return sizing.index(Hash{}(value)); }
+
+        // hash policy
+        float load_factor() const { return static_cast<float>(_size) / table.size(); }
+        float max_load_factor() const { return _max_load_factor; }
+
+        void max_load_factor(float max) {
+            if (max <= 0) throw std::invalid_argument("invalid max load factor value");
+            _max_load_factor = max;
+            if (load_factor() > _max_load_factor) {
+                rehash(Sizing::next_size(table.size()));
+            }
+        }
+
+        void rehash(size_t num_buckets) {
+            if (num_buckets == table.size()) return; // nothing to do
+            if (_size > num_buckets * _max_load_factor)
+                num_buckets = _size / _max_load_factor; // minimum number of buckets needed if passed something that will cause rehash
+            num_buckets = Sizing::valid_size(num_buckets);
+            if (num_buckets == table.size()) return;
+
+            // swap the old blocks out and move their keys across
+            vector<Block, rebind_alloc_t<Allocator, Block>> old_table(num_buckets, table.get_allocator());
+            vector<Block, rebind_alloc_t<Allocator, Block>> old_overflows(overflows.get_allocator());
+            table.swap(old_table);
+            overflows.swap(old_overflows);
+            free_overflow = npos;
+            sizing.resize(table.size());
+
+            for (Block& bucket : old_table) {
+                for (Block* block = &bucket; block; block = block->overflow == npos ? nullptr : &old_overflows[block->overflow]) {
+                    for (size_t i = 0; i < block->count; i++) {
+                        size_t index = sizing.index(Hash{}(block->keys[i]));
+                        place(std::move(block->keys[i]), index);
+                    }
+                }
+            }
+        }
+
+        // visualization
+        void print_table(std::ostream& os = std::cout) const {
+            if (is_empty()) {
+                os << "<empty>" << endl;
+                return;
+            }
+
+            for (size_t index = 0; index < table.size(); index++) {
+                if (table[index].count != 0) {
+                    os << index << ": [";
+                    bool first = true;
+                    for (const Block* block = &table[index]; block; block = next_block(*block)) {
+                        for (size_t i = 0; i < block->count; i++) {
+                            if (!first)
+                                os << ", ";
+                            os << block->keys[i];
+                            first = false;
+                        }
+                    }
+                    os << "]" << endl;
+                }
+            }
+        }
+
+        // FOR TESTING BUCKET INTERFACE METHODS
+        size_t hash(const Key& value) { return Hash{}(value); }
+        size_t overflow_block_count() const { return overflows.size(); }
+};
+
+// HashTable allocating from a std::pmr::memory_resource
+namespace pmr {
+    template <class Key, class Hash=std::hash<Key>, class KeyEqual=std::equal_to<Key>, class Sizing=PrimeModuloSizing>
+    using HashTable = ::HashTable<Key, Hash, KeyEqual, Sizing, std::pmr::polymorphic_allocator<Key>>;
+}
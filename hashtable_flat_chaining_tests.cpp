@@ -0,0 +1,199 @@
+#include "hashtable_flat_chaining.h"
+#include <sstream>
+#include <string>
+#include <iostream>
+
+#define black   "\033[30m"
+#define red     "\033[31m"
+#define green   "\033[32m"
+#define yellow  "\033[33m"
+#define blue    "\033[34m"
+#define magenta "\033[35m"
+#define cyan    "\033[36m"
+#define white   "\033[37m"
+#define reset   "\033[m"
+
+#define to_be ==
+#define not_to_be !=
+#define is to_be
+#define is_not not_to_be
+
+#define expect(X) try {\
+  if (!(X)) {\
+    std::cout << red "  [fail]" reset " (" << __FILE__ << ":" << __FUNCTION__ << ":" << __LINE__ << ") " << red << "expected " << #X << "." << reset << std::endl;\
+  }\
+} catch(...) {\
+  std::cout << red "  [fail]" reset " (" << __FILE__ << ":" << __FUNCTION__ << ":" << __LINE__ << ") " << red << #X << " threw an unexpected exception." << reset << std::endl;\
+}
+
+#define assert(X) try {\
+  if (!(X)) {\
+    std::cout << red "  [fail]" reset " (" << __FILE__ << ":" << __FUNCTION__ << ":" << __LINE__ << ") " << red << "failed assertion that " << #X << "." << reset << std::endl;\
+    std::abort();\
+  }\
+} catch(...) {\
+  std::cout << red "  [fail]" reset " (" << __FILE__ << ":" << __FUNCTION__ << ":" << __LINE__ << ") " << red << #X << " assertion threw an unexpected exception." << reset << std::endl;\
+}
+
+#define expect_throw(X,E) {\
+  bool threw_expected_exception = false;\
+  try { X; }\
+  catch(const E& err) {\
+    threw_expected_exception = true;\
+  } catch(...) {\
+    std::cout << blue << "  [help] " << #X << " threw an incorrect exception." << reset << std::endl;\
+  }\
+  if (!threw_expected_exception) {\
+    std::cout << red <<"  [fail]" << reset << " (" << __FILE__ << ":" << __FUNCTION__ << ":" << __LINE__ << ") " << red << "expected " << #X << " to throw " << #E <<"." << reset <<std::endl;\
+  }\
+}
+
+#define expect_no_throw(X) {\
+  try { X; }\
+  catch(...) {\
+    std::cout << red << "  [fail]" << red << " (" << __FILE__ << ":" << __FUNCTION__ << ":" << __LINE__ << ") " << red << "expected " << #X << " not to throw an excpetion." << reset << std::endl;\
+  }\
+}
+
+
+// hash which sends every key to the same bucket, so every bucket operation has to go through overflow blocks
+struct ConstantHash {
+    size_t operator()(int) const { return 0; }
+};
+
+int main() {
+    // is_empty() / make_empty
+    {
+        HashTable<int> intTable;
+        expect(intTable.is_empty() to_be true);
+        intTable.insert(1);
+        expect(intTable.is_empty() to_be false);
+        intTable.make_empty();
+        expect(intTable.is_empty() to_be true);
+        expect(intTable.contains(1) to_be false);
+        expect(intTable.bucket_count() to_be 11);
+    }
+
+    // constructors
+    {
+        HashTable<int> intTable;
+        expect(intTable.size() to_be 0);
+        expect(intTable.bucket_count() to_be 11);
+        expect(intTable.bucket_capacity to_be 14); // 4 byte keys in a 64 byte bucket with 8 bytes of bookkeeping
+        expect(intTable.max_load_factor() to_be 7);
+
+        HashTable<std::string> stringTable(23);
+        expect(stringTable.bucket_count() to_be 23);
+        expect(stringTable.bucket_capacity to_be 1);
+        expect(stringTable.max_load_factor() to_be 1);
+    }
+
+    // insert / remove / contains
+    {
+        HashTable<int> intTable;
+        expect(intTable.insert(1) to_be true);
+        expect(intTable.insert(1) to_be false);
+        expect(intTable.insert(12) to_be true); // same bucket as 1
+        expect(intTable.contains(1) to_be true);
+        expect(intTable.contains(12) to_be true);
+        expect(intTable.contains(23) to_be false);
+        expect(intTable.size() to_be 2);
+        expect(intTable.remove(1) to_be 1);
+        expect(intTable.remove(1) to_be 0);
+        expect(intTable.contains(1) to_be false);
+        expect(intTable.contains(12) to_be true);
+        expect(intTable.size() to_be 1);
+
+        HashTable<std::string> stringTable;
+        std::string moved = "moved";
+        expect(stringTable.insert(std::move(moved)) to_be true);
+        expect(stringTable.insert("copied") to_be true);
+        expect(stringTable.contains("moved") to_be true);
+        expect(stringTable.contains("copied") to_be true);
+        expect(stringTable.remove("moved") to_be 1);
+        expect(stringTable.contains("moved") to_be false);
+    }
+
+    // bucket interface
+    {
+        HashTable<int> intTable;
+        for (int i = 0; i < 5; i++) intTable.insert(i * 11); // all in bucket 0
+        intTable.insert(3);
+        expect(intTable.bucket(22) to_be 0);
+        expect(intTable.bucket(3) to_be 3);
+        expect(intTable.bucket_size(0) to_be 5);
+        expect(intTable.bucket_size(3) to_be 1);
+        expect(intTable.bucket_size(4) to_be 0);
+        expect_throw(intTable.bucket_size(11), std::out_of_range);
+        expect(intTable.load_factor() to_be static_cast<float>(6) / 11);
+        expect(intTable.overflow_block_count() to_be 0);
+    }
+
+    // overflow blocks
+    {
+        HashTable<int, ConstantHash> intTable;
+        intTable.max_load_factor(100);
+        for (int i = 0; i < 50; i++) expect(intTable.insert(i) to_be true);
+        expect(intTable.bucket_size(0) to_be 50);
+        expect(intTable.overflow_block_count() to_be 3); // 14 inline, then 14 + 14 + 8
+        for (int i = 0; i < 50; i++) assert(intTable.contains(i) to_be true);
+        expect(intTable.contains(50) to_be false);
+
+        for (int i = 0; i < 50; i += 2) expect(intTable.remove(i) to_be 1);
+        expect(intTable.bucket_size(0) to_be 25);
+        for (int i = 0; i < 50; i++) assert(intTable.contains(i) to_be (i % 2 == 1));
+        for (int i = 0; i < 50; i += 2) expect(intTable.insert(i) to_be true);
+        expect(intTable.overflow_block_count() to_be 3); // emptied blocks were reused
+        for (int i = 0; i < 50; i++) assert(intTable.contains(i) to_be true);
+    }
+
+    // insert which cause a rehash
+    {
+        HashTable<int> intTable;
+        for (int i = 0; i < 77; i++) intTable.insert(i); // 7 per bucket
+        expect(intTable.bucket_count() to_be 11);
+        intTable.insert(77);
+        expect(intTable.bucket_count() to_be 23);
+        for (int i = 0; i < 78; i++) expect(intTable.contains(i) to_be true);
+
+        HashTable<int, std::hash<int>, std::equal_to<int>, PowerOfTwoSizing> largeTable;
+        for (int i = 0; i < 100000; i++) largeTable.insert(i * 7);
+        expect(largeTable.size() to_be 100000);
+        expect((largeTable.load_factor() <= largeTable.max_load_factor()) to_be true);
+        for (int i = 0; i < 100000; i++) assert(largeTable.contains(i * 7) to_be true);
+        for (int i = 0; i < 100000; i++) assert(largeTable.contains(i * 7 + 1) to_be false);
+
+        HashTable<int> rehashTable;
+        for (int i = 0; i < 20; i++) rehashTable.insert(i);
+        rehashTable.rehash(101);
+        expect(rehashTable.bucket_count() to_be 101);
+        for (int i = 0; i < 20; i++) expect(rehashTable.contains(i) to_be true);
+        expect_throw(rehashTable.max_load_factor(0), std::invalid_argument);
+    }
+
+    // allocators
+    {
+        std::pmr::monotonic_buffer_resource arena;
+        pmr::HashTable<std::string> stringTable(11, &arena);
+        for (int i = 0; i < 100; i++) stringTable.insert(std::to_string(i));
+        for (int i = 0; i < 100; i++) assert(stringTable.contains(std::to_string(i)) to_be true);
+        expect(stringTable.get_allocator().resource() to_be &arena);
+    }
+
+    // print table
+    {
+        HashTable<int> intTable;
+        std::stringstream emptyss;
+        intTable.print_table(emptyss);
+        expect(emptyss.str() to_be "<empty>\n");
+
+        intTable.insert(2);
+        intTable.insert(13);
+        intTable.insert(3);
+        std::stringstream ss;
+        intTable.print_table(ss);
+        expect(ss.str() to_be "2: [2, 13]\n3: [3]\n");
+    }
+
+    return 0;
+}
@@ -1,127 +1,1417 @@
 /*
  *  Open addressing hashtable implemeneted using quadratic probing. Max load factor set to .5 by default
+ *  Table sizes and index reduction come from the Sizing policy (see hashtable_policies.h). Power of two sizes probe
+ *  with triangular numbers instead of squares, since squares only reach a fraction of a power of two table.
+ *  OpenAddressingTable is the engine, HashTable (a set of keys) and HashMap (keys with mapped values) are built on it.
+ *  How cells are laid out in memory is up to the Layout policy, how collisions are resolved to the Probing policy
+ *  (see below). Cell memory comes from Allocator, pmr::HashTable and pmr::HashMap use a std::pmr::memory_resource.
+ *  Rehashing and bulk construction can be spread over several threads (rehash_threads, HashTable(first, last, threads)).
+ *  With the CollectStats policy the table counts its probes and rehashes, see stats() and hashtable_policies.h.
+ *  Iterators, for_each and extract_all walk the cells in memory order.
+ *  Tables of trivially copyable values can be saved to a snapshot file and loaded back, or mapped read only, see save().
+ *  Any table can be streamed with write() and read(), a binary format that loads without hashing or comparing keys.
  *  Written by Zach Schrag
 */
 
 #pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <functional>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
 #include <vector>
 #include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <tuple>
+#include <type_traits>
 #include <iostream> // for print_table only
+#include "hashtable_policies.h"
+
+// load_mmap() needs POSIX mmap
+#if __has_include(<sys/mman.h>) && !defined(HASHTABLE_NO_MMAP)
+#define HASHTABLE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 using std::vector, std::cout, std::endl;
 
-template <class Key, class Hash=std::hash<Key>>
-class HashTable {
+// cell status. PENDING only exists while deleted cells are being purged
+enum class CellStatus : int8_t { DELETED = -1, EMPTY = 0, ACTIVE = 1, PENDING = 2 };
 
-    private:
-        struct Cell {
-            // constants for cell status
-            #define EMPTY_CELL 0
-            #define ACTIVE_CELL 1
-            #define DELETED_CELL -1
-
-            int status;
-            Key value;
-            Cell() : status(EMPTY_CELL), value{} {}
-            explicit Cell(const Key& value) : status(ACTIVE_CELL), value{value} {}
-        };
+// a cell as returned by at(), whatever the layout
+template <class Value>
+struct OpenAddressingCell {
+    CellStatus status;
+    Value value;
+    OpenAddressingCell() : status(CellStatus::EMPTY), value{} {}
+    OpenAddressingCell(CellStatus status, const Value& value) : status(status), value{value} {}
+};
+
+/*
+ *  Snapshot files (save(), load(), load_mmap()). A SnapshotHeader, then each array of the table's storage in the order
+ *  for_each_array() gives them, every one starting on a snapshot_alignment boundary so a mapped file can be read in
+ *  place. The arrays are the cells exactly as they sit in memory, so a snapshot is only readable by the same table type
+ *  built for the same architecture. fingerprint catches a mismatched key type, layout, probing or sizing policy, and
+ *  checksum a damaged file.
+*/
+constexpr char snapshot_magic[8] = {'H', 'T', 'S', 'N', 'A', 'P', '\0', '\0'};
+constexpr uint32_t snapshot_version = 1;
+constexpr size_t snapshot_alignment = 64;
+constexpr uint64_t snapshot_checksum_seed = 0x9E3779B97F4A7C15;
+
+inline size_t snapshot_align(size_t bytes) { return (bytes + snapshot_alignment - 1) / snapshot_alignment * snapshot_alignment; }
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t cell_bytes;
+    uint64_t fingerprint;
+    uint64_t table_size;
+    uint64_t size;
+    uint64_t deleted_cells;
+    float max_load_factor;
+    float max_tombstone_ratio;
+    uint64_t checksum; // of the arrays, padding excluded
+};
+
+// 64-bit checksum of bytes, continuing from checksum. a word at a time, to keep up with reading the file
+inline uint64_t snapshot_checksum(const char* data, size_t bytes, uint64_t checksum = snapshot_checksum_seed) {
+    constexpr uint64_t multiplier = 0xBF58476D1CE4E5B9;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= bytes; i += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        checksum = ((checksum ^ word) * multiplier) ^ (checksum >> 29);
+    }
+    for (; i < bytes; i++) checksum = ((checksum ^ static_cast<unsigned char>(data[i])) * multiplier) ^ (checksum >> 29);
+    return checksum ^ (checksum >> 32);
+}
+
+/*
+ *  Layout policies. Each provides storage<Key, Slot, Allocator>, constructed from a size and an allocator, with size(),
+ *  status(i), set_status(i, status), value(i), prefetch(i), swap(other) and get_allocator(). is_reserved(key) is true
+ *  for keys the layout can't store. in_place_purge is false when the layout has no room for a PENDING status, deleted
+ *  cells are then purged by rebuilding the table at the same size. cell_bytes is the memory one cell takes.
+ *  caches_hash layouts also keep each active value's full hash, hash(i) and set_hash(i, hash).
+ *  For snapshots, for_each_array(f) calls f(data, bytes) for each array the storage keeps, and view is a read only
+ *  size(), status(i), value(i) (and hash(i)) over those arrays as a snapshot file lays them out.
+ *
+ *  CellLayout                    - one array of {status, value} cells. the default
+ *  SplitLayout                   - an array of one byte statuses next to an array of values, so values aren't padded
+ *                                  out to fit a status beside them. a HashTable<int64_t> cell drops from 16 to 9 bytes
+ *  SentinelLayout<Empty, Deleted> - integer keys only. no status is stored: a cell whose key is Empty is empty, Deleted
+ *                                  is deleted. those two keys can't be inserted. a HashTable<int64_t> cell is 8 bytes
+ *  CachedHashLayout<Layout>      - Layout plus an array of the values' hashes. rehashes and robin hood displacement read
+ *                                  the stored hash instead of calling Hash, and lookups compare hashes before keys, so
+ *                                  KeyEqual only runs on a likely match. worth 8 bytes a cell when Hash or KeyEqual is
+ *                                  expensive, long strings for example
+*/
+struct CellLayout {
+    template <class Key, class Slot, class Allocator>
+    class storage {
+        private:
+            using Value = typename Slot::value_type;
+            using Cell = OpenAddressingCell<Value>;
+            vector<Cell, rebind_alloc_t<Allocator, Cell>> cells;
+
+        public:
+            static constexpr bool in_place_purge = true;
+            static constexpr bool caches_hash = false;
+            static constexpr size_t cell_bytes = sizeof(Cell);
+            template <class K>
+            static bool is_reserved(const K&) { return false; }
+
+            storage(size_t size, const Allocator& allocator) : cells(size, rebind_alloc_t<Allocator, Cell>(allocator)) {}
+
+            size_t size() const { return cells.size(); }
+            CellStatus status(size_t index) const { return cells[index].status; }
+            void set_status(size_t index, CellStatus status) { cells[index].status = status; }
+            Value& value(size_t index) { return cells[index].value; }
+            const Value& value(size_t index) const { return cells[index].value; }
+            void prefetch(size_t index) const { ::prefetch(&cells[index]); }
+            void swap(storage& other) { cells.swap(other.cells); }
+            Allocator get_allocator() const { return Allocator(cells.get_allocator()); }
+
+            template <class F>
+            void for_each_array(F f) const { f(reinterpret_cast<const char*>(cells.data()), cells.size() * sizeof(Cell)); }
+            template <class F>
+            void for_each_array(F f) { f(reinterpret_cast<char*>(cells.data()), cells.size() * sizeof(Cell)); }
+
+            class view {
+                private:
+                    const Cell* cells;
+                    size_t cell_count;
+
+                public:
+                    static constexpr bool caches_hash = false;
+                    // file bytes taken by the arrays of a size cell table
+                    static size_t bytes(size_t size) { return snapshot_align(size * sizeof(Cell)); }
+
+                    view(const char* data, size_t size) : cells{reinterpret_cast<const Cell*>(data)}, cell_count{size} {}
+
+                    size_t size() const { return cell_count; }
+                    CellStatus status(size_t index) const { return cells[index].status; }
+                    const Value& value(size_t index) const { return cells[index].value; }
+                    template <class F>
+                    void for_each_array(F f) const { f(reinterpret_cast<const char*>(cells), cell_count * sizeof(Cell)); }
+            };
+    };
+};
+
+struct SplitLayout {
+    template <class Key, class Slot, class Allocator>
+    class storage {
+        private:
+            using Value = typename Slot::value_type;
+            vector<CellStatus, rebind_alloc_t<Allocator, CellStatus>> statuses;
+            vector<Value, rebind_alloc_t<Allocator, Value>> values;
+
+        public:
+            static constexpr bool in_place_purge = true;
+            static constexpr bool caches_hash = false;
+            static constexpr size_t cell_bytes = sizeof(CellStatus) + sizeof(Value);
+            template <class K>
+            static bool is_reserved(const K&) { return false; }
+
+            storage(size_t size, const Allocator& allocator)
+                : statuses(size, CellStatus::EMPTY, rebind_alloc_t<Allocator, CellStatus>(allocator)), values(size, rebind_alloc_t<Allocator, Value>(allocator)) {}
+
+            size_t size() const { return values.size(); }
+            CellStatus status(size_t index) const { return statuses[index]; }
+            void set_status(size_t index, CellStatus status) { statuses[index] = status; }
+            Value& value(size_t index) { return values[index]; }
+            const Value& value(size_t index) const { return values[index]; }
+            void prefetch(size_t index) const {
+                ::prefetch(&statuses[index]);
+                ::prefetch(&values[index]);
+            }
+            void swap(storage& other) {
+                statuses.swap(other.statuses);
+                values.swap(other.values);
+            }
+            Allocator get_allocator() const { return Allocator(values.get_allocator()); }
+
+            template <class F>
+            void for_each_array(F f) const {
+                f(reinterpret_cast<const char*>(statuses.data()), statuses.size() * sizeof(CellStatus));
+                f(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(Value));
+            }
+            template <class F>
+            void for_each_array(F f) {
+                f(reinterpret_cast<char*>(statuses.data()), statuses.size() * sizeof(CellStatus));
+                f(reinterpret_cast<char*>(values.data()), values.size() * sizeof(Value));
+            }
+
+            class view {
+                private:
+                    const CellStatus* statuses;
+                    const Value* values;
+                    size_t cell_count;
+
+                public:
+                    static constexpr bool caches_hash = false;
+                    static size_t bytes(size_t size) { return snapshot_align(size * sizeof(CellStatus)) + snapshot_align(size * sizeof(Value)); }
+
+                    view(const char* data, size_t size)
+                        : statuses{reinterpret_cast<const CellStatus*>(data)},
+                          values{reinterpret_cast<const Value*>(data + snapshot_align(size * sizeof(CellStatus)))}, cell_count{size} {}
+
+                    size_t size() const { return cell_count; }
+                    CellStatus status(size_t index) const { return statuses[index]; }
+                    const Value& value(size_t index) const { return values[index]; }
+                    template <class F>
+                    void for_each_array(F f) const {
+                        f(reinterpret_cast<const char*>(statuses), cell_count * sizeof(CellStatus));
+                        f(reinterpret_cast<const char*>(values), cell_count * sizeof(Value));
+                    }
+            };
+    };
+};
+
+template <auto EmptyKey, auto DeletedKey>
+struct SentinelLayout {
+    static_assert(EmptyKey != DeletedKey, "empty and deleted sentinel keys must differ");
+
+    template <class Key, class Slot, class Allocator>
+    class storage {
+        static_assert(std::is_integral_v<Key>, "SentinelLayout is for integer keys");
+
+        private:
+            using Value = typename Slot::value_type;
+            vector<Value, rebind_alloc_t<Allocator, Value>> values;
+
+            static Value sentinel(Key key) {
+                Value value{};
+                Slot::key(value) = key;
+                return value;
+            }
+
+            static CellStatus status_of(const Value& value) {
+                const Key& key = Slot::key(value);
+                if (key == static_cast<Key>(EmptyKey)) return CellStatus::EMPTY;
+                if (key == static_cast<Key>(DeletedKey)) return CellStatus::DELETED;
+                return CellStatus::ACTIVE;
+            }
+
+        public:
+            static constexpr bool in_place_purge = false;
+            static constexpr bool caches_hash = false;
+            static constexpr size_t cell_bytes = sizeof(Value);
+            template <class K>
+            static bool is_reserved(const K& key) { return key == static_cast<Key>(EmptyKey) || key == static_cast<Key>(DeletedKey); }
+
+            storage(size_t size, const Allocator& allocator)
+                : values(size, sentinel(static_cast<Key>(EmptyKey)), rebind_alloc_t<Allocator, Value>(allocator)) {}
 
-        vector<Cell> table;
+            size_t size() const { return values.size(); }
+            CellStatus status(size_t index) const { return status_of(values[index]); }
+            void set_status(size_t index, CellStatus status) { // an active cell is marked by the value written into it
+                if (status == CellStatus::EMPTY) Slot::key(values[index]) = static_cast<Key>(EmptyKey);
+                else if (status == CellStatus::DELETED) Slot::key(values[index]) = static_cast<Key>(DeletedKey);
+            }
+            Value& value(size_t index) { return values[index]; }
+            const Value& value(size_t index) const { return values[index]; }
+            void prefetch(size_t index) const { ::prefetch(&values[index]); }
+            void swap(storage& other) { values.swap(other.values); }
+            Allocator get_allocator() const { return Allocator(values.get_allocator()); }
+
+            template <class F>
+            void for_each_array(F f) const { f(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(Value)); }
+            template <class F>
+            void for_each_array(F f) { f(reinterpret_cast<char*>(values.data()), values.size() * sizeof(Value)); }
+
+            class view {
+                private:
+                    const Value* values;
+                    size_t cell_count;
+
+                public:
+                    static constexpr bool caches_hash = false;
+                    static size_t bytes(size_t size) { return snapshot_align(size * sizeof(Value)); }
+
+                    view(const char* data, size_t size) : values{reinterpret_cast<const Value*>(data)}, cell_count{size} {}
+
+                    size_t size() const { return cell_count; }
+                    CellStatus status(size_t index) const { return status_of(values[index]); }
+                    const Value& value(size_t index) const { return values[index]; }
+                    template <class F>
+                    void for_each_array(F f) const { f(reinterpret_cast<const char*>(values), cell_count * sizeof(Value)); }
+            };
+    };
+};
+
+template <class Layout=CellLayout>
+struct CachedHashLayout {
+    template <class Key, class Slot, class Allocator>
+    class storage : public Layout::template storage<Key, Slot, Allocator> {
+        private:
+            using Base = typename Layout::template storage<Key, Slot, Allocator>;
+            vector<size_t, rebind_alloc_t<Allocator, size_t>> hashes; // only meaningful for active cells
+
+        public:
+            static constexpr bool caches_hash = true;
+            static constexpr size_t cell_bytes = Base::cell_bytes + sizeof(size_t);
+
+            storage(size_t size, const Allocator& allocator) : Base(size, allocator), hashes(size, rebind_alloc_t<Allocator, size_t>(allocator)) {}
+
+            size_t hash(size_t index) const { return hashes[index]; }
+            void set_hash(size_t index, size_t hash_value) { hashes[index] = hash_value; }
+            void prefetch(size_t index) const {
+                Base::prefetch(index);
+                ::prefetch(&hashes[index]);
+            }
+            void swap(storage& other) {
+                Base::swap(other);
+                hashes.swap(other.hashes);
+            }
+
+            template <class F>
+            void for_each_array(F f) const {
+                Base::for_each_array(f);
+                f(reinterpret_cast<const char*>(hashes.data()), hashes.size() * sizeof(size_t));
+            }
+            template <class F>
+            void for_each_array(F f) {
+                Base::for_each_array(f);
+                f(reinterpret_cast<char*>(hashes.data()), hashes.size() * sizeof(size_t));
+            }
+
+            class view : public Base::view {
+                private:
+                    const size_t* hashes;
+
+                public:
+                    static constexpr bool caches_hash = true;
+                    static size_t bytes(size_t size) { return Base::view::bytes(size) + snapshot_align(size * sizeof(size_t)); }
+
+                    view(const char* data, size_t size)
+                        : Base::view(data, size), hashes{reinterpret_cast<const size_t*>(data + Base::view::bytes(size))} {}
+
+                    size_t hash(size_t index) const { return hashes[index]; }
+                    template <class F>
+                    void for_each_array(F f) const {
+                        Base::view::for_each_array(f);
+                        f(reinterpret_cast<const char*>(hashes), this->size() * sizeof(size_t));
+                    }
+            };
+    };
+};
+
+/*
+ *  Probing policies. sequence picks the cells a key's probe visits after its home cell, robin_hood selects the
+ *  collision handling, default_max_load_factor and max_load_factor_limit bound the max load factor, supports says
+ *  which Sizing policies the sequence works with. over prime and power of two sizes every sequence but quadratic over
+ *  prime sizes visits every cell of the table. no probe runs longer than the cells its sequence can reach: an insert,
+ *  rehash or migration that finds no open cell there grows the table instead of probing forever, which also covers
+ *  composite sizes a caller asked for, where quadratic probing and double hashing reach fewer cells.
+ *
+ *  QuadraticProbing  - quadratic probing over prime sizes, triangular over power of two sizes, lazy deletion with
+ *                      tombstones. the default. a prime table's sequence only reaches half its cells, so it only
+ *                      guarantees an open cell up to half full, which is also its limit
+ *  TriangularProbing - triangular probing (offsets 1, 3, 6, 10...), power of two sizes only. the same sequence
+ *                      QuadraticProbing uses there, but a prime Sizing is a compile error rather than half coverage
+ *  LinearProbing     - the next cell each time, with tombstones. best locality, longest clusters
+ *  DoubleHashProbing - a fixed stride taken from the hash's high bits, odd over power of two sizes and below the size
+ *                      otherwise, so it is coprime with prime and power of two sizes. keys sharing a home cell go
+ *                      their separate ways
+ *  RobinHoodProbing  - linear probing where an insert takes the cell of any resident closer to its home cell than the
+ *                      value being inserted is, which keeps every probe sequence short and sorted by displacement. a
+ *                      lookup stops at the first resident closer to home than it, and a remove shifts the rest of
+ *                      the cluster back one cell instead of leaving a tombstone. fine up to 0.9 full
+*/
+enum class ProbeSequence { QUADRATIC, LINEAR, DOUBLE_HASH };
+
+struct QuadraticProbing {
+    static constexpr ProbeSequence sequence = ProbeSequence::QUADRATIC;
+    static constexpr bool robin_hood = false;
+    static constexpr float default_max_load_factor = 0.5f;
+    template <class Sizing>
+    static constexpr float max_load_factor_limit = Sizing::power_of_two ? 0.95f : 0.5f;
+    template <class Sizing>
+    static constexpr bool supports = true;
+};
+
+struct TriangularProbing : QuadraticProbing {
+    template <class Sizing>
+    static constexpr float max_load_factor_limit = 0.95f;
+    template <class Sizing>
+    static constexpr bool supports = Sizing::power_of_two;
+};
+
+struct LinearProbing {
+    static constexpr ProbeSequence sequence = ProbeSequence::LINEAR;
+    static constexpr bool robin_hood = false;
+    static constexpr float default_max_load_factor = 0.5f;
+    template <class Sizing>
+    static constexpr float max_load_factor_limit = 0.95f;
+    template <class Sizing>
+    static constexpr bool supports = true;
+};
+
+struct DoubleHashProbing {
+    static constexpr ProbeSequence sequence = ProbeSequence::DOUBLE_HASH;
+    static constexpr bool robin_hood = false;
+    static constexpr float default_max_load_factor = 0.5f;
+    template <class Sizing>
+    static constexpr float max_load_factor_limit = 0.95f;
+    template <class Sizing>
+    static constexpr bool supports = true;
+};
+
+struct RobinHoodProbing {
+    static constexpr ProbeSequence sequence = ProbeSequence::LINEAR;
+    static constexpr bool robin_hood = true;
+    static constexpr float default_max_load_factor = 0.875f;
+    template <class Sizing>
+    static constexpr float max_load_factor_limit = 0.95f;
+    template <class Sizing>
+    static constexpr bool supports = true;
+};
+
+template <class Key, class Slot, class Hash, class KeyEqual, class Sizing, class Layout, class Probing, class Allocator, class Stats>
+class OpenAddressingTable : protected Stats {
+    static_assert(Probing::template supports<Sizing>, "probing policy does not support this sizing policy");
+
+    protected:
+        using Value = typename Slot::value_type;
+        using Cell = OpenAddressingCell<Value>;
+        using Storage = typename Layout::template storage<Key, Slot, Allocator>;
+
+        // enables the lookup overloads taking any key type Hash and KeyEqual accept, see is_transparent_lookup. K keeps
+        // the condition dependent so it can be used with enable_if
+        template <class K>
+        static constexpr bool transparent = is_transparent_lookup<Hash, KeyEqual>::value && !std::is_same_v<K, Key>;
+
+        Storage table;
         size_t _size; // active cell count
         size_t deleted_cell_count;
         float _max_load_factor;
+        float _max_tombstone_ratio; // deleted cells / table size that triggers an in-place cleanup
+
+
+        // maps hashes to cells, kept in sync with table.size() through resize()
+        Sizing sizing;
+
+        // incremental rehash. while old_table is not empty the table is moving from it to table, old_table's cells
+        // before migrated have been moved. each insert or remove handles the next migration_step cells, never fewer than
+        // _rehash_step (0 means rehashes are done all at once)
+        Storage old_table;
+        Sizing old_sizing;
+        size_t migrated;
+        size_t migration_step;
+        size_t _rehash_step;
+
+        // threads rehash() may use, see rehash_threads()
+        unsigned _rehash_threads;
+
+        // position of the i-th probe given the position of the (i - 1)-th in a table of size cells, stride being
+        // probe_stride() of the key's hash. collision resolution is up to Probing::sequence: quadratic probing (offset
+        // i * i from the home cell) over prime sizes and triangular probing (offset i * (i + 1) / 2) over power of two
+        // sizes, the next cell, or a step of stride. stepping from the previous position keeps multiplication and
+        // division out of the probe loop, and nothing in it can overflow.
+        static size_t next_probe(size_t index, size_t i, size_t size, size_t stride) {
+            if constexpr (Probing::sequence == ProbeSequence::LINEAR) {
+                return index + 1 == size ? 0 : index + 1;
+            } else if constexpr (Probing::sequence == ProbeSequence::DOUBLE_HASH) {
+                if constexpr (Sizing::power_of_two) return (index + stride) & (size - 1);
+                index += stride;
+                return index >= size ? index - size : index;
+            } else if constexpr (Sizing::power_of_two) {
+                return (index + i) & (size - 1);
+            } else {
+                size_t step = 2 * i - 1;
+                if (step >= size) step %= size;
+                index += step;
+                return index >= size ? index - size : index;
+            }
+        }
+        size_t next_probe(size_t index, size_t i, size_t stride) const { return next_probe(index, i, table.size(), stride); }
 
+        // double hashing's step for hash_value in a table of size cells, from the bits the index doesn't use. only
+        // coprime with prime and power of two sizes, see probe_limit(). 0 for the other sequences, which don't need one
+        static size_t probe_stride(size_t hash_value, size_t size) {
+            if constexpr (Probing::sequence != ProbeSequence::DOUBLE_HASH) {
+                return 0;
+            } else {
+                size_t high = PowerOfTwoSizing::mix(hash_value) >> (sizeof(size_t) * 4);
+                if constexpr (Sizing::power_of_two) return high | 1;
+                return size > 1 ? 1 + high % (size - 1) : 1;
+            }
+        }
+
+        // probes it takes to visit every cell a probe sequence can reach in a table of size cells, counting the home
+        // cell. no probe loop goes further. a composite size may leave some of those cells unreachable, the loops
+        // that place values then report no open cell and the table grows
+        static size_t probe_limit(size_t size) {
+            if constexpr (Probing::sequence == ProbeSequence::QUADRATIC && !Sizing::power_of_two) return size / 2 + 1;
+            return size;
+        }
+
+        // hash of the active value at index of cells, read from the cell when the layout caches it
+        size_t stored_hash(const Storage& cells, size_t index) const {
+            if constexpr (Storage::caches_hash) return cells.hash(index);
+            else return Hash{}(Slot::key(cells.value(index)));
+        }
+
+        // whether the active value at index of cells has key. with cached hashes a differing hash rules it out before
+        // KeyEqual is called
+        template <class Cells, class K>
+        static bool matches(const Cells& cells, size_t index, const K& key, size_t hash_value) {
+            if constexpr (Cells::caches_hash) {
+                if (cells.hash(index) != hash_value) return false;
+            }
+            return KeyEqual{}(Slot::key(cells.value(index)), key);
+        }
+
+        // writes value and its hash into cell index and marks it active
+        void write_cell(size_t index, Value&& value, size_t hash_value) {
+            table.value(index) = std::move(value);
+            if constexpr (Storage::caches_hash) table.set_hash(index, hash_value);
+            table.set_status(index, CellStatus::ACTIVE);
+        }
+
+        // moves the value (and hash) in cell from to cell to, the statuses are up to the caller
+        void move_cell(size_t from, size_t to) {
+            table.value(to) = std::move(table.value(from));
+            if constexpr (Storage::caches_hash) table.set_hash(to, table.hash(from));
+        }
+
+        // robin hood: how many cells the active value at index sits past its home cell
+        size_t displacement(size_t index) const {
+            size_t home = sizing.index(stored_hash(table, index));
+            return index >= home ? index - home : index + table.size() - home;
+        }
+
+        // probes a lookup of the active value at index takes, counting the home cell
+        size_t probe_length(size_t index) const {
+            if constexpr (Probing::robin_hood) return displacement(index) + 1;
+            size_t hash_value = stored_hash(table, index);
+            size_t stride = probe_stride(hash_value, table.size()), length = 1;
+            for (size_t probe = sizing.index(hash_value); probe != index; length++)
+                probe = next_probe(probe, length, stride);
+            return length;
+        }
+
+        // single walk of the probe sequence for key, whose hash has already been computed. returns {index, true} for
+        // the cell holding key, otherwise {index, false} where index is the first deleted cell passed on the way (so
+        // tombstones get reused), the empty cell that ended the search, or table.size() if the walk reached its limit
+        // without passing either. robin hood stops early at the first resident
+        // displaced less than key would be there, key can't be further along. adds the cells it probed to probes, the
+        // caller counts the lookup once it knows the outcome
+        template <class K>
+        std::pair<size_t, bool> find_slot(const K& key, size_t hash_value, size_t& probes) const {
+            if constexpr (Probing::robin_hood) {
+                size_t index = sizing.index(hash_value);
+                for (size_t distance = 0; distance < table.size(); distance++, index = next_probe(index, 0, 0)) {
+                    if (table.status(index) == CellStatus::EMPTY) return searched({index, false}, distance + 1, probes);
+                    if (matches(table, index, key, hash_value)) return searched({index, true}, distance + 1, probes);
+                    if (displacement(index) < distance) return searched({index, false}, distance + 1, probes);
+                }
+                return searched({index, false}, table.size(), probes);
+            }
+
+            size_t first_deleted = table.size();
+            size_t index = sizing.index(hash_value);
+            size_t stride = probe_stride(hash_value, table.size()), limit = probe_limit(table.size());
+            for (size_t i = 1; i <= limit; index = next_probe(index, i++, stride)) { // obtain our next attempt at a location
+                CellStatus status = table.status(index);
+                if (status == CellStatus::EMPTY)
+                    return searched({first_deleted != table.size() ? first_deleted : index, false}, i, probes);
+                if (status == CellStatus::ACTIVE) {
+                    if (matches(table, index, key, hash_value)) return searched({index, true}, i, probes);
+                } else if (first_deleted == table.size()) {
+                    first_deleted = index;
+                }
+            }
+            return searched({first_deleted, false}, limit, probes); // table.size() if every reachable cell is active
+        }
+
+        // find_slot() for a probe that isn't a lookup of its own, such as the second one an insert makes after a resize
+        template <class K>
+        std::pair<size_t, bool> find_slot(const K& key, size_t hash_value) const {
+            size_t probes = 0;
+            return find_slot(key, hash_value, probes);
+        }
+
+        // adds the taken probes of a find_slot() result to probes
+        static std::pair<size_t, bool> searched(std::pair<size_t, bool> result, size_t taken, size_t& probes) {
+            probes += taken;
+            return result;
+        }
+
+        // cell of cells (sized by sizing) holding key, cells.size() if there is none. walks the whole probe sequence up
+        // to an empty cell, stopping at no robin hood displacement, so it only needs the read only calls a storage view
+        // also has. adds the cells it probed to probes
+        template <class Cells, class K>
+        static size_t find_in(const Cells& cells, const Sizing& sizing, const K& key, size_t hash_value, size_t& probes) {
+            size_t index = sizing.index(hash_value);
+            size_t stride = probe_stride(hash_value, cells.size()), limit = probe_limit(cells.size());
+            for (size_t i = 1; i <= limit; index = next_probe(index, i++, cells.size(), stride)) {
+                CellStatus status = cells.status(index);
+                if (status == CellStatus::EMPTY || (status == CellStatus::ACTIVE && matches(cells, index, key, hash_value))) {
+                    probes += i;
+                    return status == CellStatus::EMPTY ? cells.size() : index;
+                }
+            }
+            probes += limit;
+            return cells.size();
+        }
 
-        // Primality test in C-family on Wikipedia: https://en.wikipedia.org/wiki/Primality_test#C,_C++,_C#_&_D - this is not my algorithm
-        bool is_prime(size_t n) {
-            if (n == 2 || n == 3) return true;
-            if (n <= 1 || n % 2 == 0 || n % 3 == 0) return false;
-            for (size_t i = 5; i * i <= n; i += 6)
-                if (n % i == 0 || n % (i + 2) == 0) return false;
-        
-            return true;
+        // cell holding key in old_table, old_table.size() if there is none. robin hood order no longer holds once cells
+        // have been migrated out
+        template <class K>
+        size_t find_in_old(const K& key, size_t hash_value, size_t& probes) const {
+            return find_in(old_table, old_sizing, key, hash_value, probes);
+        }
+
+        // the value with key, from whichever table holds it, nullptr if neither does. counts one search with the Stats
+        // policy, over both tables
+        template <class K>
+        const Value* find_value(const K& key, size_t hash_value) const {
+            size_t probes = 0;
+            const Value* value = nullptr;
+            auto [index, found] = find_slot(key, hash_value, probes);
+            if (found) {
+                value = &table.value(index);
+            } else if (is_rehashing()) {
+                size_t old_index = find_in_old(key, hash_value, probes);
+                if (old_index != old_table.size()) value = &old_table.value(old_index);
+            }
+            this->count_search(value != nullptr, probes);
+            return value;
         }
 
-        // helper method for rehashing 
-        size_t find_next_prime(size_t size) {
-            size_t ret = size * 2 + 1;
-            while (!is_prime(ret)) ret += 2; 
-            return ret;
+        // moves the active value at old_index into table. the old cell is marked deleted, not empty, so the probe
+        // sequences running through it stay intact. returns the cell the value ended up in
+        size_t migrate_cell(size_t old_index) {
+            size_t index = place_or_grow(std::move(old_table.value(old_index)), stored_hash(old_table, old_index));
+            old_table.set_status(old_index, CellStatus::DELETED);
+            return index;
+        }
+
+        // moves the next count cells of old_table across, and drops old_table once all of it has been
+        void migrate(size_t count) {
+            if (!is_rehashing()) return;
+            [[maybe_unused]] auto timer = this->time_rehash();
+            for (; count != 0 && migrated < old_table.size(); migrated++, count--) {
+                if (old_table.status(migrated) == CellStatus::ACTIVE) migrate_cell(migrated);
+            }
+            if (is_rehashing() && migrated == old_table.size()) old_table = Storage{0, table.get_allocator()};
+        }
+
+        // grows to size cells, incrementally if enabled. a rehash still in progress is finished first
+        void grow(size_t size) {
+            finish_rehash();
+            if (_rehash_step == 0) {
+                rehash(size);
+                return;
+            }
+
+            this->count_rehash();
+            Storage new_table{size, table.get_allocator()};
+            table.swap(new_table);
+            old_table.swap(new_table);
+            old_sizing = sizing;
+            sizing.resize(table.size());
+            deleted_cell_count = 0;
+            migrated = 0;
+            // at least _rehash_step, and enough that the old cells are gone before inserts alone can fill the new ones
+            float headroom = std::max(1.0f, table.size() * _max_load_factor - _size);
+            migration_step = std::max(_rehash_step, static_cast<size_t>(std::ceil(old_table.size() / headroom)));
+            migrate(migration_step);
+        }
+
+        // removes every deleted cell without changing the table size. each active value is marked pending, then moved to
+        // the first cell of its probe sequence that is empty or still pending (swapping with the pending value in the
+        // latter case). no placed value can have skipped over a pending cell, so emptying one never breaks a probe chain.
+        void purge_deleted_cells() {
+            if constexpr (!Storage::in_place_purge) {
+                rehash(table.size());
+                return;
+            }
+            this->count_rehash();
+            [[maybe_unused]] auto timer = this->time_rehash();
+
+            for (size_t index = 0; index < table.size(); index++)
+                table.set_status(index, table.status(index) == CellStatus::ACTIVE ? CellStatus::PENDING : CellStatus::EMPTY);
+
+            for (size_t index = 0; index < table.size(); index++) {
+                while (table.status(index) == CellStatus::PENDING) {
+                    size_t hash_value = stored_hash(table, index);
+                    size_t target = sizing.index(hash_value), stride = probe_stride(hash_value, table.size());
+                    for (size_t i = 1; table.status(target) == CellStatus::ACTIVE; i++)
+                        target = next_probe(target, i, stride);
+
+                    if (target == index) {
+                        table.set_status(index, CellStatus::ACTIVE);
+                    } else if (table.status(target) == CellStatus::EMPTY) {
+                        move_cell(index, target);
+                        table.set_status(target, CellStatus::ACTIVE);
+                        table.set_status(index, CellStatus::EMPTY);
+                    } else { // pending: take its place and process the displaced value next
+                        std::swap(table.value(target), table.value(index));
+                        if constexpr (Storage::caches_hash) {
+                            table.set_hash(index, table.hash(target));
+                            table.set_hash(target, hash_value);
+                        }
+                        table.set_status(target, CellStatus::ACTIVE);
+                    }
+                }
+            }
+            deleted_cell_count = 0;
+        }
+
+        // robin hood insert of a value known not to be in the table. walks from its home cell and swaps it with the first
+        // resident displaced less than it, then carries on with that resident, until an empty cell takes whatever is
+        // being carried. returns the cell value itself ended up in. the walk visits each cell at most once, a table
+        // with no empty cell left can't take the value.
+        size_t robin_hood_place(Value&& value, size_t hash_value) {
+            size_t landed = table.size();
+            size_t index = sizing.index(hash_value);
+            for (size_t step = 0, distance = 0; step < table.size(); step++, distance++, index = next_probe(index, 0, 0)) {
+                if (table.status(index) == CellStatus::EMPTY) {
+                    write_cell(index, std::move(value), hash_value);
+                    return landed != table.size() ? landed : index;
+                }
+                size_t resident = displacement(index);
+                if (resident < distance) {
+                    std::swap(table.value(index), value);
+                    if constexpr (Storage::caches_hash) {
+                        size_t carried = table.hash(index);
+                        table.set_hash(index, hash_value);
+                        hash_value = carried;
+                    }
+                    if (landed == table.size()) landed = index;
+                    distance = resident;
+                }
+            }
+            throw std::length_error("hashtable has no empty cell left");
+        }
+
+        // first empty cell of the probe sequence of hash_value, table.size() if there is none within probe_limit().
+        // not for robin hood tables
+        size_t open_cell(size_t hash_value) const {
+            size_t index = sizing.index(hash_value);
+            size_t stride = probe_stride(hash_value, table.size()), limit = probe_limit(table.size());
+            for (size_t i = 1; i <= limit; index = next_probe(index, i++, stride)) {
+                if (table.status(index) == CellStatus::EMPTY) return index;
+            }
+            return table.size();
+        }
+
+        // places a value with hash hash_value known not to be in the table into the first empty cell of its probe
+        // sequence, returns that cell. used while rebuilding or migrating, when no duplicate check is needed. returns
+        // table.size(), leaving value alone, if the probe sequence has no empty cell.
+        size_t place(Value&& value, size_t hash_value) {
+            if constexpr (Probing::robin_hood) {
+                return robin_hood_place(std::move(value), hash_value);
+            }
+
+            size_t index = open_cell(hash_value);
+            if (index != table.size()) write_cell(index, std::move(value), hash_value);
+            return index;
+        }
+
+        // place() that rehashes to the next size until the probe sequence of hash_value has an empty cell
+        size_t place_or_grow(Value&& value, size_t hash_value) {
+            size_t index = place(std::move(value), hash_value);
+            while (index == table.size()) {
+                rehash(Sizing::next_size(table.size()));
+                index = place(std::move(value), hash_value);
+            }
+            return index;
         }
 
         void rehash(size_t size) {
-            // save old elements 
-            vector<Cell> old_table = table;
-            this->table = vector<Cell>{size}; // all cells are initalized to empty here 
+            this->count_rehash();
+            [[maybe_unused]] auto timer = this->time_rehash();
 
-            // reinsert all old values
-            _size = 0;
+            // swap the old cells out rather than copying them, then move the active values across
+            Storage old_cells{size, table.get_allocator()}; // all cells are initalized to empty here
+            table.swap(old_cells);
+            sizing.resize(table.size());
             deleted_cell_count = 0;
-            for (Cell cell : old_table) {
-                if (cell.status == ACTIVE_CELL)
-                    insert(cell.value); // updates _size, _current_load_factor, and status of new cells
+
+            // robin hood placement depends on the order values arrive in, so it always stays on this thread
+            if (!Probing::robin_hood && _rehash_threads > 1 && old_cells.size() >= 2 * parallel_grain) {
+                vector<std::atomic<CellStatus>> claims(table.size());
+                Leftovers leftovers;
+                parallel_for(old_cells.size(), _rehash_threads, [&](size_t begin, size_t end) {
+                    for (size_t index = begin; index < end; index++) {
+                        if (old_cells.status(index) == CellStatus::ACTIVE)
+                            claim_place(std::move(old_cells.value(index)), stored_hash(old_cells, index), claims, false, leftovers);
+                    }
+                });
+                for (auto& [value, hash_value] : leftovers.values) place_or_grow(std::move(value), hash_value);
+                return;
+            }
+
+            for (size_t index = 0; index < old_cells.size(); index++) {
+                if (old_cells.status(index) == CellStatus::ACTIVE)
+                    place_or_grow(std::move(old_cells.value(index)), stored_hash(old_cells, index)); // _size is unchanged
+            }
+        }
+
+        // values claim_place() found no open cell for, with their hashes, left for the calling thread to place
+        struct Leftovers {
+            std::mutex lock{};
+            vector<std::pair<Value, size_t>> values{};
+        };
+
+        // place() for several threads at once. claims stands in for the cell statuses while they place: a thread takes
+        // an empty cell by marking it pending, writes the value, then marks it active, so no two threads write the same
+        // cell and a cell's value is only read once it is active. with check_duplicates a value whose key is already
+        // in the table is dropped. a value whose probe sequence reaches its limit goes to leftovers instead. returns
+        // whether value was placed
+        bool claim_place(Value&& value, size_t hash_value, vector<std::atomic<CellStatus>>& claims, bool check_duplicates, Leftovers& leftovers) {
+            size_t index = sizing.index(hash_value), stride = probe_stride(hash_value, table.size()), limit = probe_limit(table.size());
+            for (size_t i = 1; i <= limit; index = next_probe(index, i++, stride)) {
+                CellStatus claim = claims[index].load(std::memory_order_acquire);
+                if (claim == CellStatus::EMPTY && claims[index].compare_exchange_strong(claim, CellStatus::PENDING, std::memory_order_acquire)) {
+                    write_cell(index, std::move(value), hash_value);
+                    claims[index].store(CellStatus::ACTIVE, std::memory_order_release);
+                    return true;
+                }
+                if (!check_duplicates) continue;
+
+                while (claim == CellStatus::PENDING) {
+                    std::this_thread::yield();
+                    claim = claims[index].load(std::memory_order_acquire);
+                }
+                if (matches(table, index, Slot::key(value), hash_value)) return false;
             }
+            std::lock_guard<std::mutex> guard(leftovers.lock);
+            leftovers.values.emplace_back(std::move(value), hash_value);
+            return false;
         }
 
+        // table size that holds count keys under the default max load factor
+        static size_t size_for(size_t count) { return Sizing::fit_size(static_cast<size_t>(count / Probing::default_max_load_factor) + 1); }
+
+        // replaces the contents of a newly constructed table with the values write() wrote to is. the table is sized for
+        // all of them up front and each value is decoded straight into the empty cell its stored hash leads to: no key
+        // is hashed or compared. robin hood tables decode each value first and place it as a rehash would, which hashes
+        // the residents it displaces unless the layout caches hashes. so does a value with no empty cell in reach, and
+        // the table grows for it
+        void read_stream(std::istream& is) {
+            StreamReader in(is);
+            StreamHeader header = read_stream_header(in, Hash{}(Key{}));
+            if (header.max_load_factor > Probing::template max_load_factor_limit<Sizing>)
+                throw std::runtime_error("hashtable stream has a damaged header");
+            _max_load_factor = header.max_load_factor;
+            if (_max_tombstone_ratio > _max_load_factor) _max_tombstone_ratio = _max_load_factor;
+            size_t size = std::max(static_cast<size_t>(header.table_size), static_cast<size_t>(header.count / _max_load_factor) + 1);
+            table = Storage{Sizing::fit_size(size), table.get_allocator()};
+            sizing.resize(table.size());
+            for (uint64_t i = 0; i < header.count; i++) {
+                size_t hash_value = static_cast<size_t>(in.get<uint64_t>());
+                size_t index = table.size();
+                if constexpr (!Probing::robin_hood) index = open_cell(hash_value);
+                if (index != table.size()) {
+                    StreamCodec<Value>::read(in, table.value(index));
+                    if constexpr (Storage::caches_hash) table.set_hash(index, hash_value);
+                    table.set_status(index, CellStatus::ACTIVE);
+                } else { // robin hood, or no empty cell left in reach
+                    Value value{};
+                    StreamCodec<Value>::read(in, value);
+                    place_or_grow(std::move(value), hash_value);
+                }
+                _size++;
+            }
+            in.finish();
+        }
+
+        // inserts the count values starting at first into a table that is empty and already big enough for them, on
+        // up to threads threads. robin hood tables insert them one at a time, see rehash()
+        template <class ForwardIt>
+        void bulk_insert(ForwardIt first, size_t count, unsigned threads) {
+            if constexpr (Probing::robin_hood) {
+                for (size_t i = 0; i < count; i++, ++first) {
+                    Value value(*first);
+                    emplace_hashed(Slot::key(value), Hash{}(Slot::key(value)), std::move(value));
+                }
+                return;
+            }
+
+            vector<std::atomic<CellStatus>> claims(table.size());
+            Leftovers leftovers;
+            std::atomic<size_t> inserted{0};
+            parallel_for(count, threads, [&](size_t begin, size_t end) {
+                ForwardIt it = std::next(first, begin);
+                size_t placed = 0;
+                for (size_t i = begin; i < end; i++, ++it) {
+                    Value value(*it);
+                    if (Storage::is_reserved(Slot::key(value))) throw std::invalid_argument("key is reserved as a sentinel by the table layout");
+                    size_t hash_value = Hash{}(Slot::key(value));
+                    placed += claim_place(std::move(value), hash_value, claims, true, leftovers);
+                }
+                inserted += placed;
+            });
+            _size += inserted;
+            // these may be duplicates, and the table grows if one still has no room
+            for (auto& [value, hash_value] : leftovers.values) emplace_hashed(Slot::key(value), hash_value, std::move(value));
+        }
+
+
+        // probes once for key and, if it is absent, constructs a value from args in the cell it belongs in. returns the
+        // cell index holding key and whether an insert happened. args may refer to key, they are only used at the end.
+        template <class K, class... Args>
+        std::pair<size_t, bool> emplace_hashed(const K& key, size_t hash_value, Args&&... args) {
+            if (is_rehashing()) migrate(migration_step);
+            size_t probes = 0;
+            auto [index, found] = find_slot(key, hash_value, probes);
+            if (!found && is_rehashing()) { // not migrated yet: move it now, the caller gets a cell in table
+                size_t old_index = find_in_old(key, hash_value, probes);
+                if (old_index != old_table.size()) {
+                    index = migrate_cell(old_index);
+                    found = true;
+                }
+            }
+            this->count_search(found, probes);
+            if (found) return {index, false};
+            if (Storage::is_reserved(key)) throw std::invalid_argument("key is reserved as a sentinel by the table layout");
+
+            if constexpr (Probing::robin_hood) { // no tombstones, and the probe above can't know where displacement stops
+                if (static_cast<float>(_size + 1) / table.size() > _max_load_factor)
+                    grow(Sizing::next_size(table.size()));
+                Value value(std::forward<Args>(args)...);
+                index = robin_hood_place(std::move(value), hash_value);
+                _size++;
+                return {index, true};
+            }
+
+            // rehash check: a reused tombstone does not consume an open cell, a fresh empty cell does. counting deleted
+            // cells keeps lazy deletion from leaving the table with no open cells. only grow when the active cells need
+            // the room, otherwise clearing out the deleted cells at the same size is enough. a probe that reached its
+            // limit without finding an open cell grows the table whatever the load.
+            size_t occupied = _size + deleted_cell_count + (index != table.size() && table.status(index) == CellStatus::EMPTY ? 1 : 0);
+            if (index == table.size() || static_cast<float>(occupied) / table.size() > _max_load_factor) {
+                if (index == table.size() || static_cast<float>(_size + 1) / table.size() > _max_load_factor)
+                    grow(Sizing::next_size(table.size()));
+                else
+                    purge_deleted_cells();
+                index = find_slot(key, hash_value).first; // the only second probe, and only on a resize or purge
+                while (index == table.size()) {
+                    grow(Sizing::next_size(table.size()));
+                    index = find_slot(key, hash_value).first;
+                }
+            }
+
+            // perform insert
+            if (table.status(index) == CellStatus::DELETED) deleted_cell_count--;
+            write_cell(index, Value(std::forward<Args>(args)...), hash_value);
+            _size++;
+            return {index, true};
+        }
+
+
+        // robin hood removal of the value at index: pull each following value that isn't in its home cell back one cell,
+        // up to the end of the cluster. every probe sequence stays unbroken, so no tombstone is needed. returns how many
+        // values moved
+        size_t shift_back(size_t index) {
+            size_t next = next_probe(index, 0, 0), moved = 0;
+            while (table.status(next) == CellStatus::ACTIVE && displacement(next) > 0) {
+                move_cell(next, index);
+                index = next;
+                next = next_probe(next, 0, 0);
+                moved++;
+            }
+            table.set_status(index, CellStatus::EMPTY);
+            return moved;
+        }
+
+        // removes key, whose hash has already been computed. returns 1 on successful removal, 0 on failed removal
+        template <class K>
+        size_t remove_hashed(const K& key, size_t hash_value) {
+            if (is_rehashing()) migrate(migration_step);
+            size_t probes = 0;
+            auto [index, found] = find_slot(key, hash_value, probes);
+            if (!found) {
+                size_t old_index = is_rehashing() ? find_in_old(key, hash_value, probes) : old_table.size();
+                this->count_search(old_index != old_table.size(), probes);
+                if (old_index == old_table.size()) return 0;
+                old_table.set_status(old_index, CellStatus::DELETED); // dropped instead of migrated
+                _size--;
+                return 1;
+            }
+            this->count_search(true, probes);
+            if constexpr (Probing::robin_hood) {
+                shift_back(index);
+                _size--;
+                return 1;
+            }
+
+            // value contained, delete using lazy deletion
+            table.set_status(index, CellStatus::DELETED);
+            _size--;
+            deleted_cell_count++;
+            if (static_cast<float>(deleted_cell_count) / table.size() > _max_tombstone_ratio)
+                purge_deleted_cells();
+
+            return 1;
+        }
+
+        // iteration runs over the cells of table, then those of old_table as if they followed on. positions not yet
+        // migrated are the only active ones old_table has
+        size_t cell_count() const { return table.size() + old_table.size(); }
+        bool is_active(size_t position) const {
+            return position < table.size() ? table.status(position) == CellStatus::ACTIVE
+                                           : old_table.status(position - table.size()) == CellStatus::ACTIVE;
+        }
+        Value& cell_value(size_t position) {
+            return position < table.size() ? table.value(position) : old_table.value(position - table.size());
+        }
+        const Value& cell_value(size_t position) const {
+            return position < table.size() ? table.value(position) : old_table.value(position - table.size());
+        }
+
+        // iteration position of the value with key, cell_count() if there is none
+        template <class K>
+        size_t locate(const K& key, size_t hash_value) const {
+            size_t probes = 0, position = cell_count();
+            auto [index, found] = find_slot(key, hash_value, probes);
+            if (found) {
+                position = index;
+            } else if (is_rehashing()) {
+                size_t old_index = find_in_old(key, hash_value, probes);
+                if (old_index != old_table.size()) position = table.size() + old_index;
+            }
+            this->count_search(position != cell_count(), probes);
+            return position;
+        }
+
+        // hashes a group of keys into hashes and prefetches the home cell of each
+        void prefetch_group(const Key* keys, size_t count, size_t* hashes) const {
+            for (size_t i = 0; i < count; i++) {
+                hashes[i] = Hash{}(keys[i]);
+                table.prefetch(sizing.index(hashes[i]));
+            }
+        }
+
+        // what a snapshot's cells depend on besides the values: the key and value sizes, the layout, the probing
+        // policy, the Sizing policy (sampled at size, the snapshot's table size) and Hash (sampled on a default key)
+        static uint64_t snapshot_fingerprint(size_t size) {
+            Sizing sampled{};
+            sampled.resize(size);
+            const uint64_t traits[] = {sizeof(Key), sizeof(Value), Storage::cell_bytes, Sizing::power_of_two,
+                                       static_cast<uint64_t>(Probing::sequence), Probing::robin_hood, Storage::caches_hash,
+                                       sampled.index(0x9E3779B97F4A7C15), sampled.index(0xFFFFFFFF00000001), Hash{}(Key{})};
+            return snapshot_checksum(reinterpret_cast<const char*>(traits), sizeof(traits));
+        }
+
+        // bytes the header takes at the start of a snapshot file, the arrays follow
+        static size_t snapshot_header_bytes() { return snapshot_align(sizeof(SnapshotHeader)); }
+
+        // throws unless header describes a snapshot this table type could have written
+        static void check_snapshot(const SnapshotHeader& header, const std::string& path) {
+            if (std::memcmp(header.magic, snapshot_magic, sizeof(snapshot_magic)) != 0)
+                throw std::runtime_error(path + " is not a hashtable snapshot");
+            if (header.version != snapshot_version) throw std::runtime_error(path + " is a snapshot of an unsupported version");
+            if (header.cell_bytes != Storage::cell_bytes || header.table_size == 0 || Sizing::valid_size(header.table_size) != header.table_size ||
+                header.fingerprint != snapshot_fingerprint(header.table_size))
+                throw std::runtime_error(path + " was saved by a different table type");
+            if (header.size + header.deleted_cells > header.table_size || !(header.max_load_factor > 0) ||
+                header.max_load_factor > Probing::template max_load_factor_limit<Sizing> || !(header.max_tombstone_ratio > 0))
+                throw std::runtime_error(path + " has a damaged header");
+        }
+
+        // checksum of every array of cells, a Storage or a view
+        template <class Cells>
+        static uint64_t snapshot_checksum_of(const Cells& cells) {
+            uint64_t checksum = snapshot_checksum_seed;
+            cells.for_each_array([&](const char* data, size_t bytes) { checksum = snapshot_checksum(data, bytes, checksum); });
+            return checksum;
+        }
+
+        // replaces the table with the snapshot at path. the cell arrays are read straight into place, nothing is hashed
+        // or probed
+        void read_snapshot(const std::string& path) {
+            static_assert(Slot::trivially_copyable, "snapshots need trivially copyable keys and values");
+            std::ifstream in(path, std::ios::binary);
+            if (!in) throw std::runtime_error("cannot open " + path);
+            auto read = [&](char* data, size_t bytes) {
+                in.read(data, static_cast<std::streamsize>(bytes));
+                in.ignore(static_cast<std::streamsize>(snapshot_align(bytes) - bytes));
+                if (!in) throw std::runtime_error(path + " is truncated");
+            };
+
+            SnapshotHeader header;
+            read(reinterpret_cast<char*>(&header), sizeof(header));
+            check_snapshot(header, path);
+            Storage cells{header.table_size, table.get_allocator()};
+            cells.for_each_array(read);
+            if (snapshot_checksum_of(std::as_const(cells)) != header.checksum)
+                throw std::runtime_error(path + " is damaged, its checksum does not match");
+
+            table.swap(cells);
+            old_table = Storage{0, table.get_allocator()};
+            sizing.resize(table.size());
+            migrated = 0;
+            _size = header.size;
+            deleted_cell_count = header.deleted_cells;
+            _max_load_factor = header.max_load_factor;
+            _max_tombstone_ratio = header.max_tombstone_ratio;
+        }
 
     public:
         // constructors
-        HashTable() : table{11}, _size{0}, deleted_cell_count{0}, _max_load_factor{0.5} {}
-        explicit HashTable(size_t size) : table{size}, _size{0}, deleted_cell_count{0}, _max_load_factor{0.5} {}
+        OpenAddressingTable() : OpenAddressingTable(11) {}
+        explicit OpenAddressingTable(size_t size, const Allocator& allocator = Allocator())
+            : table{Sizing::valid_size(size), allocator}, _size{0}, deleted_cell_count{0}, _max_load_factor{Probing::default_max_load_factor},
+              _max_tombstone_ratio{0.25}, sizing{}, old_table{0, allocator}, old_sizing{}, migrated{0}, migration_step{0}, _rehash_step{0},
+              _rehash_threads{1} {
+            sizing.resize(table.size());
+        }
+
+        Allocator get_allocator() const { return table.get_allocator(); }
 
         // capacity
         bool is_empty() const { return _size == 0; }
         size_t size() const { return _size; }
         size_t table_size() const { return table.size(); }
 
+        // grows the table, with a single rehash, so that count values fit under the current max load factor without
+        // another. never shrinks it
+        void reserve(size_t count) {
+            size_t size = Sizing::fit_size(static_cast<size_t>(count / static_cast<double>(_max_load_factor)) + 1);
+            if (size <= table.size()) return;
+            finish_rehash();
+            rehash(size);
+        }
+        // rebuilds the table at the smallest size that holds its values under the max load factor, dropping every
+        // deleted cell
+        void shrink_to_fit() {
+            finish_rehash();
+            size_t size = Sizing::fit_size(static_cast<size_t>(_size / static_cast<double>(_max_load_factor)) + 1);
+            if (size != table.size() || deleted_cell_count != 0) rehash(size);
+        }
+
+        // forward iterator over the values, in cell order. inserts, remove(), rehashes and the like invalidate every
+        // iterator, erase() the one erased and, in a robin hood table, the ones after it
+        template <bool Const>
+        class Iterator {
+            private:
+                using Owner = std::conditional_t<Const, const OpenAddressingTable, OpenAddressingTable>;
+                Owner* owner;
+                size_t position; // see cell_count()
+                // robin hood erase() wrapped values already visited from the start of the table to [skip_from, its end)
+                size_t skip_from;
+
+                void skip_inactive() {
+                    while (position < owner->cell_count()) {
+                        if (position == skip_from) position = owner->table.size();
+                        else if (!owner->is_active(position)) position++;
+                        else break;
+                    }
+                }
+
+                friend class OpenAddressingTable;
+
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = Value;
+                using difference_type = std::ptrdiff_t;
+                // map iterators hand out a MapReference, so their keys are read only
+                using reference = std::conditional_t<Const, typename Slot::const_reference, typename Slot::reference>;
+                using pointer = std::conditional_t<std::is_reference_v<reference>, std::remove_reference_t<reference>*, ArrowProxy<reference>>;
+
+                Iterator() : owner{nullptr}, position{0}, skip_from{SIZE_MAX} {}
+                Iterator(Owner* owner, size_t position, size_t skip_from = SIZE_MAX)
+                    : owner{owner}, position{position}, skip_from{skip_from} { skip_inactive(); }
+                Iterator(const Iterator&) = default;
+                Iterator& operator=(const Iterator&) = default;
+                operator Iterator<true>() const { return Iterator<true>(owner, position, skip_from); }
+
+                reference operator*() const { return owner->cell_value(position); }
+                pointer operator->() const {
+                    if constexpr (std::is_reference_v<reference>) return &owner->cell_value(position);
+                    else return pointer{**this};
+                }
+                Iterator& operator++() {
+                    position++;
+                    skip_inactive();
+                    return *this;
+                }
+                Iterator operator++(int) {
+                    Iterator previous = *this;
+                    ++*this;
+                    return previous;
+                }
+                bool operator==(const Iterator& other) const { return position == other.position; }
+                bool operator!=(const Iterator& other) const { return position != other.position; }
+        };
+        using iterator = Iterator<false>;
+        using const_iterator = Iterator<true>;
+
+        // iterators
+        iterator begin() { return iterator(this, 0); }
+        iterator end() { return iterator(this, cell_count()); }
+        const_iterator begin() const { return const_iterator(this, 0); }
+        const_iterator end() const { return const_iterator(this, cell_count()); }
+        const_iterator cbegin() const { return begin(); }
+        const_iterator cend() const { return end(); }
+
+        // calls f(value) for every value, in one pass over the cells. f must not change the table
+        template <class F>
+        void for_each(F f) const {
+            for (size_t position = 0; position < cell_count(); position++) {
+                if (is_active(position)) f(cell_value(position));
+            }
+        }
+
+        // moves every value out in one pass over the cells, leaving the table empty at its current size
+        vector<Value> extract_all() {
+            vector<Value> values;
+            values.reserve(_size);
+            for (size_t position = 0; position < cell_count(); position++) {
+                if (is_active(position)) values.push_back(std::move(cell_value(position)));
+            }
+            make_empty();
+            return values;
+        }
+
         // modifiers
         void make_empty() {
-            table = vector<Cell>{table.size()};
+            table = Storage{table.size(), table.get_allocator()};
+            old_table = Storage{0, table.get_allocator()};
             _size = 0;
             deleted_cell_count = 0;
         }
 
-        bool insert(const Key& value) { // returns true on successful insert, false on failed insert
-            if (contains(value)) return false;
+        size_t remove(const Key& key) { return remove<Key, true>(key); } // returns 1 on successful removal, 0 on failed removal.
+        template <class K, bool Enable = transparent<K>, class = std::enable_if_t<Enable>>
+        size_t remove(const K& key) { return remove_hashed(key, Hash{}(key)); }
+        // with hash_value already computed, it must be Hash{}(key)
+        size_t remove(const Key& key, size_t hash_value) { return remove<Key, true>(key, hash_value); }
+        template <class K, bool Enable = transparent<K>, class = std::enable_if_t<Enable>>
+        size_t remove(const K& key, size_t hash_value) { return remove_hashed(key, hash_value); }
 
-            // rehash check: second condition is for a series of insertions followed by deltions which never cause a rehash but lazy deletion leaves no open cells.
-            if (static_cast<float>(_size + 1) / table.size() > _max_load_factor ||
-                static_cast<float>(1 + _size + deleted_cell_count) / table.size() > _max_load_factor)
-                rehash(find_next_prime(table.size()));
-
-            // perform insert
-            table.at(position(value)) = Cell(value);
-            // update members
-            _size++;
-            return true;
-        }
-        
-        size_t remove(const Key& value) { // returns 1 on successful removal, 0 on failed removal.
-            if (!contains(value)) return 0;
-            // value not contained, delete using lazy deletion
-            table.at(position(value)).status = DELETED_CELL;
+        // removes the value at position, returns the iterator to the value after it. never rehashes or purges deleted
+        // cells, so the other iterators stay valid, except in a robin hood table: there the values after it shift back a
+        // cell, and the iterators past it may then point at another value or skip one
+        iterator erase(const_iterator position) {
+            size_t index = position.position;
             _size--;
+            if (index >= table.size()) { // not migrated yet: dropped instead
+                old_table.set_status(index - table.size(), CellStatus::DELETED);
+                return iterator(this, index + 1);
+            }
+            if constexpr (Probing::robin_hood) {
+                // a value shifted from the start of the table to its end was visited already, and so are the ones the
+                // iterator skips if the shift reached them
+                size_t skip_from = position.skip_from, last = index + shift_back(index);
+                if (skip_from < table.size() && last >= skip_from) skip_from--;
+                else if (last >= table.size()) skip_from = table.size() - 1;
+                return iterator(this, index, skip_from);
+            }
+            table.set_status(index, CellStatus::DELETED);
             deleted_cell_count++;
+            return iterator(this, index + 1);
+        }
 
-            return 1;
+        // removes each of keys[0, count), returns how many were in the table
+        size_t remove_batch(const Key* keys, size_t count) {
+            size_t hashes[prefetch_group_size];
+            size_t removed = 0;
+            for (size_t group = 0; group < count; group += prefetch_group_size) {
+                size_t group_size = std::min(prefetch_group_size, count - group);
+                prefetch_group(keys + group, group_size, hashes);
+                for (size_t i = 0; i < group_size; i++) removed += remove_hashed(keys[group + i], hashes[i]);
+            }
+            return removed;
+        }
+        // load factor
+        float load_factor() const { return static_cast<float>(_size) / table.size(); }
+        float max_load_factor() const { return _max_load_factor; }
+
+        // grows the table if it is already over the new max. limited to what the probing policy supports
+        void max_load_factor(float max) {
+            if (max <= 0 || max > Probing::template max_load_factor_limit<Sizing>)
+                throw std::invalid_argument("invalid max load factor value");
+            finish_rehash();
+            _max_load_factor = max;
+            if (_max_tombstone_ratio > _max_load_factor) _max_tombstone_ratio = _max_load_factor;
+
+            size_t size = table.size();
+            while (static_cast<float>(_size) / size > _max_load_factor) size = Sizing::next_size(size);
+            if (size != table.size()) rehash(size);
+        }
+
+        // longest probe sequence any key in the table takes to be found, counting the home cell. O(table size)
+        size_t max_probe_length() const {
+            size_t longest = 0;
+            for (size_t index = 0; index < table.size(); index++) {
+                if (table.status(index) == CellStatus::ACTIVE) longest = std::max(longest, probe_length(index));
+            }
+            return longest;
+        }
+
+        // statistics, with the CollectStats policy only (see hashtable_policies.h). chain_lengths is the probe length of
+        // every key in the table, the counters cover everything since construction or reset_stats(). O(table size)
+        TableStats stats() const {
+            static_assert(Stats::enabled, "stats() needs the CollectStats policy");
+            TableStats result;
+            this->read_counters(result);
+            for (size_t index = 0; index < table.size(); index++) {
+                if (table.status(index) != CellStatus::ACTIVE) continue;
+                size_t length = probe_length(index);
+                if (length >= result.chain_lengths.size()) result.chain_lengths.resize(length + 1);
+                result.chain_lengths[length]++;
+            }
+            result.tombstones = deleted_cell_count;
+            result.tombstone_ratio = tombstone_ratio();
+            result.bytes_allocated = (table.size() + old_table.size()) * Storage::cell_bytes;
+            return result;
+        }
+        void reset_stats() { this->reset_counters(); }
+
+        // incremental rehash. with a step of n, growing the table only allocates the new cells, then every insert and
+        // remove moves at least the next n of the old ones across (more if needed to be done before the next growth), so
+        // no single call pays for the whole rehash. lookups check both until it is done, and an insert or remove of a
+        // key that hasn't been moved yet moves or drops it. lookups never move anything, so const calls stay read only.
+        // a step of 0 (the default) rehashes all at once, setting it finishes any rehash in progress
+        size_t incremental_rehash() const { return _rehash_step; }
+        void incremental_rehash(size_t step) {
+            if (step == 0) finish_rehash();
+            _rehash_step = step;
+        }
+        bool is_rehashing() const { return old_table.size() != 0; }
+        // fraction of the old cells moved so far, 1 when no rehash is in progress
+        float rehash_progress() const { return is_rehashing() ? static_cast<float>(migrated) / old_table.size() : 1.0f; }
+        void finish_rehash() { migrate(old_table.size()); }
+
+        // parallel rehash. growing or rebuilding a table of at least 2 * parallel_grain cells spreads the work over up
+        // to threads threads, each placing the values of its own range of old cells. 1 (the default) keeps it on the
+        // calling thread. robin hood tables always rehash on the calling thread
+        unsigned rehash_threads() const { return _rehash_threads; }
+        void rehash_threads(unsigned threads) {
+            if (threads == 0) throw std::invalid_argument("rehash needs at least one thread");
+            _rehash_threads = threads;
+        }
+
+        // tombstone policy
+        float tombstone_ratio() const { return static_cast<float>(deleted_cell_count) / table.size(); }
+        float max_tombstone_ratio() const { return _max_tombstone_ratio; }
+
+        void max_tombstone_ratio(float max) {
+            if (max <= 0 || max > _max_load_factor) throw std::invalid_argument("invalid max tombstone ratio value");
+            _max_tombstone_ratio = max;
+            if (tombstone_ratio() > _max_tombstone_ratio)
+                purge_deleted_cells();
         }
 
         // lookup
-        bool contains(const Key& value) const {
-            return table.at(position(value)).status == ACTIVE_CELL;
+        bool contains(const Key& key) const { return contains<Key, true>(key); }
+        template <class K, bool Enable = transparent<K>, class = std::enable_if_t<Enable>>
+        bool contains(const K& key) const {
+            return find_value(key, Hash{}(key)) != nullptr;
+        }
+        // with hash_value already computed (kept from another table, or sent along with the key), it must be Hash{}(key)
+        bool contains(const Key& key, size_t hash_value) const { return contains<Key, true>(key, hash_value); }
+        template <class K, bool Enable = transparent<K>, class = std::enable_if_t<Enable>>
+        bool contains(const K& key, size_t hash_value) const {
+            return find_value(key, hash_value) != nullptr;
         }
 
-        // position
-        size_t position(const Key& value) const {
-            // collision resolution done using quadratic probing
-            int i = 0;
-            while (true) {
-                size_t index = (Hash{}(value) + i * i) % table.size(); // obtain our attempt at a location
-                if (table.at(index).status == EMPTY_CELL || table.at(index).value == value)
-                    return index; // found an available cell or index value should be
-                i++; // else incremenet i and try again
+        // results[i] = contains(keys[i]) for each of keys[0, count), returns how many were found
+        size_t contains_batch(const Key* keys, size_t count, bool* results) const {
+            size_t hashes[prefetch_group_size];
+            size_t found = 0;
+            for (size_t group = 0; group < count; group += prefetch_group_size) {
+                size_t group_size = std::min(prefetch_group_size, count - group);
+                prefetch_group(keys + group, group_size, hashes);
+                for (size_t i = 0; i < group_size; i++) {
+                    results[group + i] = find_value(keys[group + i], hashes[i]) != nullptr;
+                    found += results[group + i];
+                }
             }
+            return found;
+        }
+
+        // position
+        size_t position(const Key& key) const { return position<Key, true>(key); }
+        template <class K, bool Enable = transparent<K>, class = std::enable_if_t<Enable>>
+        size_t position(const K& key) const {
+            return position<K, true>(key, Hash{}(key));
+        }
+        size_t position(const Key& key, size_t hash_value) const { return position<Key, true>(key, hash_value); }
+        template <class K, bool Enable = transparent<K>, class = std::enable_if_t<Enable>>
+        size_t position(const K& key, size_t hash_value) const {
+            size_t probes = 0;
+            auto [index, found] = find_slot(key, hash_value, probes);
+            this->count_search(found, probes);
+            return index;
         }
 
         // visualization
@@ -131,15 +1421,383 @@ class HashTable {
                 return;
             }
 
-            for (Cell cell : table) {
-                if (cell.status == ACTIVE_CELL) {
-                    os << position(cell.value) << ": ";
-                    os << cell.value << endl;
+            for (size_t index = 0; index < table.size(); index++) {
+                if (table.status(index) == CellStatus::ACTIVE) {
+                    os << index << ": ";
+                    Slot::print(os, table.value(index));
+                    os << endl;
+                }
+            }
+            for (size_t index = migrated; index < old_table.size(); index++) { // not migrated yet
+                if (old_table.status(index) == CellStatus::ACTIVE) {
+                    os << "old " << index << ": ";
+                    Slot::print(os, old_table.value(index));
+                    os << endl;
                 }
             }
         }
 
+        // serialization, see StreamCodec in hashtable_policies.h. writes a header, then cell by cell each value's hash and
+        // encoding. HashTable::read and HashMap::read load it back
+        void write(std::ostream& os) const {
+            StreamWriter out(os);
+            write_stream_header(out, {_size, table.size(), _max_load_factor, Hash{}(Key{})});
+            for (const Storage* cells : {&table, &old_table}) {
+                for (size_t index = 0; index < cells->size(); index++) {
+                    if (cells->status(index) != CellStatus::ACTIVE) continue;
+                    out.put(static_cast<uint64_t>(stored_hash(*cells, index)));
+                    StreamCodec<Value>::write(out, cells->value(index));
+                }
+            }
+            out.flush();
+        }
+
+        // snapshots, see SnapshotHeader. writes the table to path, finishing any incremental rehash first. HashTable and
+        // HashMap read it back with load(), or map it with load_mmap()
+        void save(const std::string& path) {
+            static_assert(Slot::trivially_copyable, "snapshots need trivially copyable keys and values");
+            finish_rehash();
+            SnapshotHeader header;
+            std::memcpy(header.magic, snapshot_magic, sizeof(snapshot_magic));
+            header.version = snapshot_version;
+            header.cell_bytes = static_cast<uint32_t>(Storage::cell_bytes);
+            header.fingerprint = snapshot_fingerprint(table.size());
+            header.table_size = table.size();
+            header.size = _size;
+            header.deleted_cells = deleted_cell_count;
+            header.max_load_factor = _max_load_factor;
+            header.max_tombstone_ratio = _max_tombstone_ratio;
+            header.checksum = snapshot_checksum_of(table);
+
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            if (!out) throw std::runtime_error("cannot open " + path + " for writing");
+            auto write = [&](const char* data, size_t bytes) {
+                static const char padding[snapshot_alignment] = {};
+                out.write(data, static_cast<std::streamsize>(bytes));
+                out.write(padding, static_cast<std::streamsize>(snapshot_align(bytes) - bytes));
+            };
+            write(reinterpret_cast<const char*>(&header), sizeof(header));
+            table.for_each_array(write);
+            out.flush();
+            if (!out) throw std::runtime_error("cannot write " + path);
+        }
+
+#ifdef HASHTABLE_MMAP
+        // read only table over a snapshot mapped into memory, see load_mmap(). lookups probe the mapped cells in place,
+        // so opening one costs no more than the header checks, and pages are read in as lookups touch them. the mapping
+        // is shared: processes mapping the same file share one copy of it in memory. verify also checks the checksum,
+        // which reads every page up front: it catches a damaged file, but gives up the cold start that only pays for
+        // the pages lookups touch. unverified, a damaged cell is only found, if at all, by the lookups that read it
+        class MappedTable {
+            private:
+                using View = typename Storage::view;
+                void* mapping; // nullptr once moved from
+                size_t length;
+                SnapshotHeader header;
+                View cells;
+                Sizing sizing;
+
+            public:
+                explicit MappedTable(const std::string& path, bool verify = false)
+                    : mapping{nullptr}, length{0}, header{}, cells{nullptr, 0}, sizing{} {
+                    static_assert(Slot::trivially_copyable, "snapshots need trivially copyable keys and values");
+                    int file = ::open(path.c_str(), O_RDONLY);
+                    if (file < 0) throw std::runtime_error("cannot open " + path);
+                    struct stat status;
+                    bool stated = ::fstat(file, &status) == 0;
+                    if (stated && static_cast<size_t>(status.st_size) >= snapshot_header_bytes()) {
+                        length = static_cast<size_t>(status.st_size);
+                        mapping = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, file, 0);
+                        if (mapping == MAP_FAILED) mapping = nullptr;
+                    }
+                    ::close(file); // the mapping keeps its own reference to the file
+                    if (!mapping) throw std::runtime_error(stated && length == 0 ? path + " is truncated" : "cannot map " + path);
+
+                    try {
+                        std::memcpy(&header, mapping, sizeof(header));
+                        check_snapshot(header, path);
+                        if (length < snapshot_header_bytes() + View::bytes(header.table_size)) throw std::runtime_error(path + " is truncated");
+                        cells = View(static_cast<const char*>(mapping) + snapshot_header_bytes(), header.table_size);
+                        if (verify && snapshot_checksum_of(cells) != header.checksum)
+                            throw std::runtime_error(path + " is damaged, its checksum does not match");
+                    } catch (...) {
+                        ::munmap(mapping, length);
+                        throw;
+                    }
+                    sizing.resize(header.table_size);
+                }
+                ~MappedTable() { if (mapping) ::munmap(mapping, length); }
+
+                MappedTable(const MappedTable&) = delete;
+                MappedTable& operator=(const MappedTable&) = delete;
+                MappedTable(MappedTable&& other) noexcept
+                    : mapping{other.mapping}, length{other.length}, header(other.header), cells{other.cells}, sizing{other.sizing} {
+                    other.mapping = nullptr;
+                }
+                MappedTable& operator=(MappedTable&&) = delete;
+
+                // capacity
+                bool is_empty() const { return header.size == 0; }
+                size_t size() const { return header.size; }
+                size_t table_size() const { return header.table_size; }
+
+                // lookup
+                bool contains(const Key& key) const { return contains<Key, true>(key); }
+                template <class K, bool Enable = transparent<K>, class = std::enable_if_t<Enable>>
+                bool contains(const K& key) const { return find<K, true>(key) != nullptr; }
+                bool contains(const Key& key, size_t hash_value) const { return contains<Key, true>(key, hash_value); }
+                template <class K, bool Enable = transparent<K>, class = std::enable_if_t<Enable>>
+                bool contains(const K& key, size_t hash_value) const { return find<K, true>(key, hash_value) != nullptr; }
+
+                // the value holding key (the key itself in a HashTable, the key/mapped value pair in a HashMap), nullptr
+                // if there is none
+                const Value* find(const Key& key) const { return find<Key, true>(key); }
+                template <class K, bool Enable = transparent<K>, class = std::enable_if_t<Enable>>
+                const Value* find(const K& key) const { return find<K, true>(key, Hash{}(key)); }
+                const Value* find(const Key& key, size_t hash_value) const { return find<Key, true>(key, hash_value); }
+                template <class K, bool Enable = transparent<K>, class = std::enable_if_t<Enable>>
+                const Value* find(const K& key, size_t hash_value) const {
+                    size_t probes = 0, index = find_in(cells, sizing, key, hash_value, probes);
+                    return index == cells.size() ? nullptr : &cells.value(index);
+                }
+
+                // calls f(value) for every value, in one pass over the cells
+                template <class F>
+                void for_each(F f) const {
+                    for (size_t index = 0; index < cells.size(); index++) {
+                        if (cells.status(index) == CellStatus::ACTIVE) f(cells.value(index));
+                    }
+                }
+        };
+#endif
+
         // FOR TESTING ONLY
-        Cell at(size_t index) { return table.at(index); }
+        Cell at(size_t index) {
+            if (index >= table.size()) throw std::out_of_range("cell index out of range");
+            return Cell(table.status(index), table.value(index));
+        }
         size_t hash(const Key& value) { return Hash{}(value); }
 };
+
+template <class Key, class Hash=std::hash<Key>, class KeyEqual=std::equal_to<Key>, class Sizing=PrimeModuloSizing, class Layout=CellLayout, class Probing=QuadraticProbing,
+          class Allocator=std::allocator<Key>, class Stats=NoStats>
+class HashTable : public OpenAddressingTable<Key, SetSlot<Key>, Hash, KeyEqual, Sizing, Layout, Probing, Allocator, Stats> {
+
+    private:
+        using Base = OpenAddressingTable<Key, SetSlot<Key>, Hash, KeyEqual, Sizing, Layout, Probing, Allocator, Stats>;
+
+    public:
+        using Base::Base;
+
+        // keys can't be changed in place, so every iterator is a const_iterator
+        using iterator = typename Base::const_iterator;
+        using const_iterator = typename Base::const_iterator;
+
+        // builds the table from the keys in [first, last) on up to threads threads, dropping duplicates. the table is
+        // sized for all of them up front so nothing is rehashed along the way
+        template <class ForwardIt, class = std::enable_if_t<!std::is_integral_v<ForwardIt>>>
+        HashTable(ForwardIt first, ForwardIt last, unsigned threads = default_thread_count(), const Allocator& allocator = Allocator())
+            : Base(Base::size_for(static_cast<size_t>(std::distance(first, last))), allocator) {
+            this->bulk_insert(first, static_cast<size_t>(std::distance(first, last)), threads);
+        }
+
+        // modifiers
+        bool insert(const Key& value) { return emplace(value).second; } // returns true on successful insert, false on failed insert
+        bool insert(Key&& value) { return emplace(std::move(value)).second; }
+        // inserts a key given as any type Hash and KeyEqual accept, a Key is only built from it if it isn't present
+        template <class K, bool Enable = Base::template transparent<K>, class = std::enable_if_t<Enable>>
+        bool insert(const K& value) { return this->emplace_hashed(value, Hash{}(value), value).second; }
+
+        // with hash_value already computed, it must be Hash{}(value)
+        bool insert(const Key& value, size_t hash_value) { return this->emplace_hashed(value, hash_value, value).second; }
+        bool insert(Key&& value, size_t hash_value) { return this->emplace_hashed(value, hash_value, std::move(value)).second; }
+        template <class K, bool Enable = Base::template transparent<K>, class = std::enable_if_t<Enable>>
+        bool insert(const K& value, size_t hash_value) { return this->emplace_hashed(value, hash_value, value).second; }
+
+        // constructs a key from args and places it with a single probe of the table. returns an iterator to the key and
+        // whether an insert happened (false if the key was already present).
+        template <class... Args>
+        std::pair<const_iterator, bool> emplace(Args&&... args) {
+            Key value(std::forward<Args>(args)...);
+            size_t hash_value = Hash{}(value);
+            auto [index, inserted] = this->emplace_hashed(value, hash_value, std::move(value));
+            return {const_iterator(this, index), inserted};
+        }
+
+        // inserts each of keys[0, count), returns how many were not already in the table
+        size_t insert_batch(const Key* keys, size_t count) {
+            size_t hashes[prefetch_group_size];
+            size_t inserted = 0;
+            for (size_t group = 0; group < count; group += prefetch_group_size) {
+                size_t group_size = std::min(prefetch_group_size, count - group);
+                this->prefetch_group(keys + group, group_size, hashes);
+                for (size_t i = 0; i < group_size; i++)
+                    inserted += this->emplace_hashed(keys[group + i], hashes[i], keys[group + i]).second;
+            }
+            return inserted;
+        }
+
+        const_iterator erase(const_iterator position) { return Base::erase(position); }
+
+        // iterators
+        const_iterator begin() const { return Base::cbegin(); }
+        const_iterator end() const { return Base::cend(); }
+
+        // lookup. end() if key is not in the table
+        const_iterator find(const Key& key) const { return find<Key, true>(key); }
+        template <class K, bool Enable = Base::template transparent<K>, class = std::enable_if_t<Enable>>
+        const_iterator find(const K& key) const { return const_iterator(this, this->locate(key, Hash{}(key))); }
+
+        // reads what write() wrote to in into a new table, see read_stream()
+        static HashTable read(std::istream& in, const Allocator& allocator = Allocator()) {
+            HashTable table(1, allocator);
+            table.read_stream(in);
+            return table;
+        }
+
+        // reads a snapshot written by save() into a new table, see read_snapshot()
+        static HashTable load(const std::string& path, const Allocator& allocator = Allocator()) {
+            HashTable table(1, allocator);
+            table.read_snapshot(path);
+            return table;
+        }
+#ifdef HASHTABLE_MMAP
+        // maps a snapshot written by save() read only, see MappedTable. verify reads the whole file once to check its
+        // checksum, off by default so only the pages lookups touch are read
+        using mapped_table = typename Base::MappedTable;
+        static mapped_table load_mmap(const std::string& path, bool verify = false) { return mapped_table(path, verify); }
+#endif
+};
+
+template <class Key, class T, class Hash=std::hash<Key>, class KeyEqual=std::equal_to<Key>, class Sizing=PrimeModuloSizing, class Layout=CellLayout, class Probing=QuadraticProbing,
+          class Allocator=std::allocator<std::pair<const Key, T>>, class Stats=NoStats>
+class HashMap : public OpenAddressingTable<Key, MapSlot<Key, T>, Hash, KeyEqual, Sizing, Layout, Probing, Allocator, Stats> {
+
+    private:
+        using Base = OpenAddressingTable<Key, MapSlot<Key, T>, Hash, KeyEqual, Sizing, Layout, Probing, Allocator, Stats>;
+
+        template <class K>
+        static constexpr bool transparent = Base::template transparent<K>;
+
+        template <class K>
+        const T* find_mapped(const K& key, size_t hash_value) const {
+            auto value = this->find_value(key, hash_value);
+            return value ? &value->second : nullptr;
+        }
+        template <class K>
+        const T* find_mapped(const K& key) const { return find_mapped(key, Hash{}(key)); }
+
+        template <class K, class... Args>
+        std::pair<T*, bool> try_emplace_key(K&& key, Args&&... args) {
+            size_t hash_value = Hash{}(key);
+            auto [index, inserted] = this->emplace_hashed(key, hash_value, std::piecewise_construct,
+                std::forward_as_tuple(std::forward<K>(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+            return {&this->table.value(index).second, inserted};
+        }
+
+    public:
+        using Base::Base;
+
+        using iterator = typename Base::iterator;
+        using const_iterator = typename Base::const_iterator;
+
+        // builds the map from the key/mapped value pairs in [first, last) on up to threads threads, dropping duplicate
+        // keys. the table is sized for all of them up front so nothing is rehashed along the way
+        template <class ForwardIt, class = std::enable_if_t<!std::is_integral_v<ForwardIt>>>
+        HashMap(ForwardIt first, ForwardIt last, unsigned threads = default_thread_count(), const Allocator& allocator = Allocator())
+            : Base(Base::size_for(static_cast<size_t>(std::distance(first, last))), allocator) {
+            this->bulk_insert(first, static_cast<size_t>(std::distance(first, last)), threads);
+        }
+
+        // lookup. nullptr if key is not in the map
+        T* find(const Key& key) { return find<Key, true>(key); }
+        const T* find(const Key& key) const { return find<Key, true>(key); }
+        template <class K, bool Enable = transparent<K>, class = std::enable_if_t<Enable>>
+        T* find(const K& key) { return const_cast<T*>(find_mapped(key)); }
+        template <class K, bool Enable = transparent<K>, class = std::enable_if_t<Enable>>
+        const T* find(const K& key) const { return find_mapped(key); }
+        // with hash_value already computed, it must be Hash{}(key)
+        T* find(const Key& key, size_t hash_value) { return find<Key, true>(key, hash_value); }
+        const T* find(const Key& key, size_t hash_value) const { return find<Key, true>(key, hash_value); }
+        template <class K, bool Enable = transparent<K>, class = std::enable_if_t<Enable>>
+        T* find(const K& key, size_t hash_value) { return const_cast<T*>(find_mapped(key, hash_value)); }
+        template <class K, bool Enable = transparent<K>, class = std::enable_if_t<Enable>>
+        const T* find(const K& key, size_t hash_value) const { return find_mapped(key, hash_value); }
+
+        // iterator to the entry with key, end() if key is not in the map. for erase() and anything else that takes one
+        iterator find_iterator(const Key& key) { return find_iterator<Key, true>(key); }
+        const_iterator find_iterator(const Key& key) const { return find_iterator<Key, true>(key); }
+        template <class K, bool Enable = transparent<K>, class = std::enable_if_t<Enable>>
+        iterator find_iterator(const K& key) { return iterator(this, this->locate(key, Hash{}(key))); }
+        template <class K, bool Enable = transparent<K>, class = std::enable_if_t<Enable>>
+        const_iterator find_iterator(const K& key) const { return const_iterator(this, this->locate(key, Hash{}(key))); }
+
+        // mapped value for key, default constructed and inserted if key is not in the map
+        T& operator[](const Key& key) { return *try_emplace(key).first; }
+        T& operator[](Key&& key) { return *try_emplace(std::move(key)).first; }
+
+        // modifiers. each returns the mapped value for key and whether an insert happened
+        bool insert(const Key& key, const T& value) { return try_emplace(key, value).second; } // returns true on successful insert, false on failed insert
+
+        // constructs a key/mapped value pair from args and inserts it if its key is not already in the map. returns an
+        // iterator to the pair with that key and whether an insert happened
+        template <class... Args>
+        std::pair<iterator, bool> emplace(Args&&... args) {
+            typename Base::Value value(std::forward<Args>(args)...);
+            size_t hash_value = Hash{}(value.first);
+            auto [index, inserted] = this->emplace_hashed(value.first, hash_value, std::move(value));
+            return {iterator(this, index), inserted};
+        }
+
+        // constructs the mapped value from args only if key is not already in the map
+        template <class... Args>
+        std::pair<T*, bool> try_emplace(const Key& key, Args&&... args) { return try_emplace_key(key, std::forward<Args>(args)...); }
+        template <class... Args>
+        std::pair<T*, bool> try_emplace(Key&& key, Args&&... args) { return try_emplace_key(std::move(key), std::forward<Args>(args)...); }
+
+        // inserts key with value, or assigns value to the existing mapped value
+        template <class M>
+        std::pair<T*, bool> insert_or_assign(const Key& key, M&& value) {
+            auto result = try_emplace(key, std::forward<M>(value));
+            if (!result.second) *result.first = std::forward<M>(value);
+            return result;
+        }
+        template <class M>
+        std::pair<T*, bool> insert_or_assign(Key&& key, M&& value) {
+            auto result = try_emplace(std::move(key), std::forward<M>(value));
+            if (!result.second) *result.first = std::forward<M>(value);
+            return result;
+        }
+
+        // reads what write() wrote to in into a new map, see read_stream()
+        static HashMap read(std::istream& in, const Allocator& allocator = Allocator()) {
+            HashMap map(1, allocator);
+            map.read_stream(in);
+            return map;
+        }
+
+        // reads a snapshot written by save() into a new table, see read_snapshot()
+        static HashMap load(const std::string& path, const Allocator& allocator = Allocator()) {
+            HashMap table(1, allocator);
+            table.read_snapshot(path);
+            return table;
+        }
+#ifdef HASHTABLE_MMAP
+        // maps a snapshot written by save() read only, see MappedTable. verify reads the whole file once to check its
+        // checksum, off by default so only the pages lookups touch are read
+        using mapped_table = typename Base::MappedTable;
+        static mapped_table load_mmap(const std::string& path, bool verify = false) { return mapped_table(path, verify); }
+#endif
+};
+
+// HashTable and HashMap allocating from a std::pmr::memory_resource, for example a monotonic_buffer_resource released
+// all at once after the table is dropped
+namespace pmr {
+    template <class Key, class Hash=std::hash<Key>, class KeyEqual=std::equal_to<Key>, class Sizing=PrimeModuloSizing, class Layout=CellLayout, class Probing=QuadraticProbing,
+              class Stats=NoStats>
+    using HashTable = ::HashTable<Key, Hash, KeyEqual, Sizing, Layout, Probing, std::pmr::polymorphic_allocator<Key>, Stats>;
+
+    template <class Key, class T, class Hash=std::hash<Key>, class KeyEqual=std::equal_to<Key>, class Sizing=PrimeModuloSizing, class Layout=CellLayout, class Probing=QuadraticProbing,
+              class Stats=NoStats>
+    using HashMap = ::HashMap<Key, T, Hash, KeyEqual, Sizing, Layout, Probing, std::pmr::polymorphic_allocator<std::pair<const Key, T>>, Stats>;
+}
@@ -1,5 +1,10 @@
 #include "hashtable_open_addressing.h"
+#include <cstdio>
+#include <fstream>
 #include <sstream>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
 #include <iostream>
 
 #define black   "\033[30m"
@@ -54,6 +59,67 @@
   }\
 }
 
+// key type which counts how many times it is copied, used to check that rehashing moves keys
+struct CopyCountedKey {
+    static int copies;
+    int value;
+    CopyCountedKey(int value = 0) : value{value} {}
+    CopyCountedKey(const CopyCountedKey& other) : value{other.value} { copies++; }
+    CopyCountedKey(CopyCountedKey&& other) = default;
+    CopyCountedKey& operator=(const CopyCountedKey& other) { value = other.value; copies++; return *this; }
+    CopyCountedKey& operator=(CopyCountedKey&& other) = default;
+    bool operator==(const CopyCountedKey& other) const { return value == other.value; }
+};
+int CopyCountedKey::copies = 0;
+
+struct CopyCountedKeyHash {
+    size_t operator()(const CopyCountedKey& key) const { return std::hash<int>{}(key.value); }
+};
+
+// transparent string hash, lets tables of std::string be searched with std::string_view and const char*
+struct StringHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view value) const { return std::hash<std::string_view>{}(value); }
+};
+
+// string hash which counts its calls, used to check that cached hashes are not recomputed
+struct CountingStringHash {
+    static int calls;
+    size_t operator()(const std::string& value) const {
+        calls++;
+        return std::hash<std::string>{}(value);
+    }
+};
+int CountingStringHash::calls = 0;
+
+// sends every key to the same home cell
+struct CollidingHash {
+    size_t operator()(int) const { return 42; }
+};
+
+// whether it->first can be assigned through an iterator of type It, which would change a key under its table
+template <class It, class = void>
+struct assignable_key : std::false_type {};
+template <class It>
+struct assignable_key<It, std::void_t<decltype(std::declval<It&>()->first = std::declval<int>())>> : std::true_type {};
+
+// memory resource which counts what is allocated from and freed back to it
+struct CountingResource : std::pmr::memory_resource {
+    size_t allocations;
+    size_t deallocations;
+    CountingResource() : allocations{0}, deallocations{0} {}
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        allocations++;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        deallocations++;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
+
 int main() {
     // is_empty() / make_empty
     {
@@ -72,7 +138,7 @@ int main() {
         expect(intTable.size() to_be 0);
         expect(intTable.table_size() to_be 11);
         for (size_t i = 0; i < intTable.table_size(); i++) {
-            expect(intTable.at(i).status == EMPTY_CELL);
+            expect(intTable.at(i).status == CellStatus::EMPTY);
         }
         expect(intTable.is_empty() to_be true);
         expect(intTable.contains(0) to_be false);
@@ -84,7 +150,7 @@ int main() {
         expect(doubleTable.size() to_be 0);
         expect(doubleTable.table_size() to_be 23);
         for (size_t i = 0; i < doubleTable.table_size(); i++) {
-            expect(doubleTable.at(i).status == EMPTY_CELL);
+            expect(doubleTable.at(i).status == CellStatus::EMPTY);
         }
         expect(doubleTable.is_empty() to_be true);
         expect(doubleTable.contains(0.0) to_be false);
@@ -137,34 +203,34 @@ int main() {
         expect(intTable.insert(1) to_be true); 
         expect(intTable.size() to_be 1);
         expect(intTable.contains(1) to_be true);
-        expect(intTable.at(1).status to_be ACTIVE_CELL);
+        expect(intTable.at(1).status to_be CellStatus::ACTIVE);
         expect(intTable.at(1).value to_be 1);
 
         expect(intTable.insert(2) to_be true);
         expect(intTable.size() to_be 2);
         expect(intTable.contains(2) to_be true);
-        expect(intTable.at(2).status to_be ACTIVE_CELL);
+        expect(intTable.at(2).status to_be CellStatus::ACTIVE);
         expect(intTable.at(2).value to_be 2);
         
         expect(intTable.insert(3) to_be true);
         expect(intTable.size() to_be 3);
         expect(intTable.contains(3) to_be true);
-        expect(intTable.at(3).status to_be ACTIVE_CELL);
+        expect(intTable.at(3).status to_be CellStatus::ACTIVE);
         expect(intTable.at(3).value to_be 3);
         // attempt insert duplicate
         expect(intTable.insert(3) to_be false);
         expect(intTable.size() to_be 3);
         expect(intTable.contains(3) to_be true);
-        expect(intTable.at(3).status to_be ACTIVE_CELL);
+        expect(intTable.at(3).status to_be CellStatus::ACTIVE);
         expect(intTable.at(3).value to_be 3);
         // check state before we insert 4
         expect(intTable.contains(4) to_be false);
-        expect(intTable.at(4).status to_be EMPTY_CELL);
+        expect(intTable.at(4).status to_be CellStatus::EMPTY);
         // after insert 4
         expect(intTable.insert(4) to_be true);
         expect(intTable.size() to_be 4);
         expect(intTable.contains(4) to_be true);
-        expect(intTable.at(4).status to_be ACTIVE_CELL);
+        expect(intTable.at(4).status to_be CellStatus::ACTIVE);
         expect(intTable.at(4).value to_be 4);
 
 
@@ -172,34 +238,34 @@ int main() {
         expect(charTable.insert('a') to_be true);
         expect(charTable.size() to_be 1);
         expect(charTable.contains('a') to_be true);
-        expect(charTable.at(charTable.hash('a') % charTable.table_size()).status to_be ACTIVE_CELL);
+        expect(charTable.at(charTable.hash('a') % charTable.table_size()).status to_be CellStatus::ACTIVE);
         expect(charTable.at(charTable.hash('a') % charTable.table_size()).value to_be 'a');
 
         expect(charTable.insert('b') to_be true);
         expect(charTable.size() to_be 2);
         expect(charTable.contains('b') to_be true);
-        expect(charTable.at(charTable.hash('b') % charTable.table_size()).status to_be ACTIVE_CELL);
+        expect(charTable.at(charTable.hash('b') % charTable.table_size()).status to_be CellStatus::ACTIVE);
         expect(charTable.at(charTable.hash('b') % charTable.table_size()).value to_be 'b');
 
         expect(charTable.insert('c') to_be true);
         expect(charTable.size() to_be 3);
         expect(charTable.contains('c') to_be true);
-        expect(charTable.at(charTable.hash('c') % charTable.table_size()).status to_be ACTIVE_CELL);
+        expect(charTable.at(charTable.hash('c') % charTable.table_size()).status to_be CellStatus::ACTIVE);
         expect(charTable.at(charTable.hash('c') % charTable.table_size()).value to_be 'c');
         // attempt insert duplicate
         expect(charTable.insert('c') to_be false);
         expect(charTable.size() to_be 3);
         expect(charTable.contains('c') to_be true);
-        expect(charTable.at(charTable.hash('c') % charTable.table_size()).status to_be ACTIVE_CELL);
+        expect(charTable.at(charTable.hash('c') % charTable.table_size()).status to_be CellStatus::ACTIVE);
         expect(charTable.at(charTable.hash('c') % charTable.table_size()).value to_be 'c');
         // check state before inserting a new value
         expect(charTable.contains('d') to_be false);
-        expect(charTable.at(charTable.hash('d') % charTable.table_size()).status to_be EMPTY_CELL);
+        expect(charTable.at(charTable.hash('d') % charTable.table_size()).status to_be CellStatus::EMPTY);
 
         expect(charTable.insert('d') to_be true);
         expect(charTable.size() to_be 4);
         expect(charTable.contains('d') to_be true);
-        expect(charTable.at(charTable.hash('d') % charTable.table_size()).status to_be ACTIVE_CELL);
+        expect(charTable.at(charTable.hash('d') % charTable.table_size()).status to_be CellStatus::ACTIVE);
         expect(charTable.at(charTable.hash('d') % charTable.table_size()).value to_be 'd');
     }
 
@@ -244,13 +310,13 @@ int main() {
 
         // remove a value
         expect(intTable.contains(6) to_be true);
-        expect(intTable.at(6).status to_be ACTIVE_CELL);
+        expect(intTable.at(6).status to_be CellStatus::ACTIVE);
         expect(intTable.at(6).value to_be 6);
         expect(intTable.size() to_be 3);
         expect(intTable.table_size() to_be 11);
         expect(intTable.remove(6) to_be 1);
         expect(intTable.contains(6) to_be false);
-        expect(intTable.at(6).status to_be DELETED_CELL);
+        expect(intTable.at(6).status to_be CellStatus::DELETED);
         expect(intTable.at(6).value to_be 6); // should still be there but as a ghost value
         expect(intTable.size() to_be 2);
         expect(intTable.table_size() to_be 11);
@@ -258,24 +324,24 @@ int main() {
         // attempt to remove value that is not in table
         expect(intTable.remove(6) to_be 0);
         expect(intTable.contains(6) to_be false);
-        expect(intTable.at(6).status to_be DELETED_CELL);
+        expect(intTable.at(6).status to_be CellStatus::DELETED);
         expect(intTable.at(6).value to_be 6);
         expect(intTable.size() to_be 2);
         expect(intTable.table_size() to_be 11);
         // remove 0
         expect(intTable.contains(0) to_be true);
-        expect(intTable.at(0).status to_be ACTIVE_CELL)
+        expect(intTable.at(0).status to_be CellStatus::ACTIVE)
         expect(intTable.at(0).value to_be 0)
         expect(intTable.remove(0) to_be 1);
         expect(intTable.contains(0) to_be false);
-        expect(intTable.at(0).status to_be DELETED_CELL);
+        expect(intTable.at(0).status to_be CellStatus::DELETED);
         expect(intTable.at(0).value to_be 0); // lazy deletion
         expect(intTable.size() to_be 1);
         expect(intTable.table_size() to_be 11);
         // reinsert 0
         expect(intTable.insert(0) to_be true);
         expect(intTable.contains(0) to_be true);
-        expect(intTable.at(0).status to_be ACTIVE_CELL);
+        expect(intTable.at(0).status to_be CellStatus::ACTIVE);
         expect(intTable.at(0).value to_be 0);
         expect(intTable.size() to_be 2);
         expect(intTable.table_size() to_be 11);
@@ -295,17 +361,17 @@ int main() {
         intTable.insert(5);
         expect(intTable.size() to_be 6);
         expect(intTable.table_size() to_be 23);
-        expect(intTable.at(0).status to_be ACTIVE_CELL);
+        expect(intTable.at(0).status to_be CellStatus::ACTIVE);
         expect(intTable.at(0).value to_be 0);
-        expect(intTable.at(1).status to_be ACTIVE_CELL);
+        expect(intTable.at(1).status to_be CellStatus::ACTIVE);
         expect(intTable.at(1).value to_be 1);
-        expect(intTable.at(2).status to_be ACTIVE_CELL);
+        expect(intTable.at(2).status to_be CellStatus::ACTIVE);
         expect(intTable.at(2).value to_be 2);
-        expect(intTable.at(3).status to_be ACTIVE_CELL);
+        expect(intTable.at(3).status to_be CellStatus::ACTIVE);
         expect(intTable.at(3).value to_be 3);
-        expect(intTable.at(4).status to_be ACTIVE_CELL);
+        expect(intTable.at(4).status to_be CellStatus::ACTIVE);
         expect(intTable.at(4).value to_be 4);
-        expect(intTable.at(5).status to_be ACTIVE_CELL);
+        expect(intTable.at(5).status to_be CellStatus::ACTIVE);
         expect(intTable.at(5).value to_be 5);
     }
 
@@ -319,64 +385,1126 @@ int main() {
         expect(intTable.insert(11) to_be true); // index 0 is taken, index 1 is taken, expect to be placed in index 4.
         expect(intTable.size() to_be 4);
         expect(intTable.table_size() to_be 11);
-        expect(intTable.at(0).status to_be ACTIVE_CELL);
+        expect(intTable.at(0).status to_be CellStatus::ACTIVE);
         expect(intTable.at(0).value not_to_be 11);
-        expect(intTable.at(1).status to_be ACTIVE_CELL);
+        expect(intTable.at(1).status to_be CellStatus::ACTIVE);
         expect(intTable.at(1).value not_to_be 11);
-        expect(intTable.at(4).status to_be ACTIVE_CELL);
+        expect(intTable.at(4).status to_be CellStatus::ACTIVE);
         expect(intTable.at(4).value to_be 11);
 
         // remove a value to ensure probing still happens past deleted cells
         expect(intTable.remove(1) to_be 1);
-        expect(intTable.at(1).status to_be DELETED_CELL);
+        expect(intTable.at(1).status to_be CellStatus::DELETED);
         expect(intTable.size() to_be 3);
-        // insert value which would hash to index 1. expect it to not be placed in 1. expect to be placed in index 5 (index 2 is taken)
+        expect(intTable.contains(12) to_be false); // probes past the deleted cell at 1 to the empty cell at 5
+        // insert value which would hash to index 1. expect the deleted cell at 1 to be reused
         expect(intTable.insert(12) to_be true);
-        expect(intTable.at(1).status to_be DELETED_CELL);
-        expect(intTable.at(1).value not_to_be 12);
-        expect(intTable.at(2).status to_be ACTIVE_CELL);
+        expect(intTable.at(1).status to_be CellStatus::ACTIVE);
+        expect(intTable.at(1).value to_be 12);
+        expect(intTable.at(2).status to_be CellStatus::ACTIVE);
         expect(intTable.at(2).value not_to_be 12);
-        expect(intTable.at(5).status to_be ACTIVE_CELL);
-        expect(intTable.at(5).value to_be 12);
+        expect(intTable.at(5).status to_be CellStatus::EMPTY);
         expect(intTable.size() to_be 4);
 
-        // expect next insert to cause rehash
+        // reused deleted cell means the next insert still fits (5 occupied cells out of 11)
         expect(intTable.insert(15) to_be true);
-        expect(intTable.table_size() to_be 23);
-        expect(intTable.at(0).status to_be ACTIVE_CELL);
-        expect(intTable.at(0).value to_be 0);
-        expect(intTable.at(1).status to_be EMPTY_CELL);
-        expect(intTable.at(1).value to_be int());
-        expect(intTable.at(2).status to_be ACTIVE_CELL);
-        expect(intTable.at(2).value to_be 2);
-        expect(intTable.at(11).status to_be ACTIVE_CELL);
-        expect(intTable.at(11).value to_be 11);
-        expect(intTable.at(12).status to_be ACTIVE_CELL);
-        expect(intTable.at(12).value to_be 12);
-        expect(intTable.at(15).status to_be ACTIVE_CELL);
-        expect(intTable.at(15).value to_be 15);
+        expect(intTable.table_size() to_be 11);
+        expect(intTable.at(5).status to_be CellStatus::ACTIVE); // 15 hashes to 4, which is taken by 11
+        expect(intTable.at(5).value to_be 15);
         expect(intTable.size() to_be 5);
 
-        // expect next insert to cause a rehash. expect to see deleted cell turned to empty and new locations of the existing elements
+        // expect next insert to cause a rehash. expect to see the new locations of the existing elements
         expect(intTable.insert(22));
         expect(intTable.table_size() to_be 23);
         expect(intTable.size() to_be 6);
-        expect(intTable.at(0).status to_be ACTIVE_CELL);
+        expect(intTable.at(0).status to_be CellStatus::ACTIVE);
         expect(intTable.at(0).value to_be 0);
-        expect(intTable.at(1).status to_be EMPTY_CELL);
+        expect(intTable.at(1).status to_be CellStatus::EMPTY);
         expect(intTable.at(1).value to_be int());
-        expect(intTable.at(2).status to_be ACTIVE_CELL);
+        expect(intTable.at(2).status to_be CellStatus::ACTIVE);
         expect(intTable.at(2).value to_be 2);
-        expect(intTable.at(11).status to_be ACTIVE_CELL);
+        expect(intTable.at(11).status to_be CellStatus::ACTIVE);
         expect(intTable.at(11).value to_be 11);
-        expect(intTable.at(12).status to_be ACTIVE_CELL);
+        expect(intTable.at(12).status to_be CellStatus::ACTIVE);
         expect(intTable.at(12).value to_be 12);
-        expect(intTable.at(15).status to_be ACTIVE_CELL);
+        expect(intTable.at(15).status to_be CellStatus::ACTIVE);
         expect(intTable.at(15).value to_be 15);
-        expect(intTable.at(22).status to_be ACTIVE_CELL);
+        expect(intTable.at(22).status to_be CellStatus::ACTIVE);
         expect(intTable.at(22).value to_be 22);
     }
 
+    // emplace
+    {
+        HashTable<std::string> stringTable;
+        auto [it, inserted] = stringTable.emplace(3, 'a');
+        expect(inserted to_be true);
+        expect(*it to_be "aaa");
+        expect((it == stringTable.find("aaa")) to_be true);
+        size_t index = stringTable.position("aaa");
+        expect(stringTable.at(index).status to_be CellStatus::ACTIVE);
+        expect(stringTable.at(index).value to_be "aaa");
+        expect(stringTable.size() to_be 1);
+
+        auto [duplicate, duplicate_inserted] = stringTable.emplace("aaa");
+        expect(duplicate_inserted to_be false);
+        expect((duplicate == it) to_be true);
+        expect(stringTable.size() to_be 1);
+
+        std::string moved = "moved into the table";
+        expect(stringTable.insert(std::move(moved)) to_be true);
+        expect(stringTable.contains("moved into the table") to_be true);
+        expect(stringTable.size() to_be 2);
+
+        // emplace returns the key's new position after a remove and reinsert too
+        expect(stringTable.remove("aaa") to_be 1);
+        auto [reinserted_it, reinserted] = stringTable.emplace("aaa");
+        expect(reinserted to_be true);
+        expect(*reinserted_it to_be "aaa");
+        expect(stringTable.position("aaa") to_be index); // deleted cell is reused
+        expect(stringTable.size() to_be 2);
+    }
+
+    // max_tombstone_ratio
+    {
+        HashTable<int> intTable;
+        expect(intTable.max_tombstone_ratio() to_be 0.25);
+        expect(intTable.tombstone_ratio() to_be 0);
+        expect_no_throw(intTable.max_tombstone_ratio(0.5));
+        expect_throw(intTable.max_tombstone_ratio(0), std::invalid_argument);
+        expect_throw(intTable.max_tombstone_ratio(-0.1), std::invalid_argument);
+        expect_throw(intTable.max_tombstone_ratio(0.75), std::invalid_argument); // above the max load factor
+    }
+
+    // removals past the tombstone ratio purge deleted cells in place
+    {
+        HashTable<int> intTable;
+        intTable.insert(0);
+        intTable.insert(11); // collides with 0, placed at 1
+        intTable.insert(2);
+        intTable.insert(3);
+        intTable.insert(4);
+        expect(intTable.remove(0) to_be 1);
+        expect(intTable.remove(2) to_be 1);
+        expect(intTable.tombstone_ratio() to_be static_cast<float>(2) / 11);
+        expect(intTable.at(0).status to_be CellStatus::DELETED);
+        // third deleted cell is over 0.25 of the table
+        expect(intTable.remove(3) to_be 1);
+        expect(intTable.tombstone_ratio() to_be 0);
+        expect(intTable.table_size() to_be 11);
+        expect(intTable.size() to_be 2);
+        expect(intTable.at(0).status to_be CellStatus::ACTIVE); // 11 moved back to its home cell
+        expect(intTable.at(0).value to_be 11);
+        expect(intTable.at(1).status to_be CellStatus::EMPTY);
+        expect(intTable.at(2).status to_be CellStatus::EMPTY);
+        expect(intTable.at(3).status to_be CellStatus::EMPTY);
+        expect(intTable.at(4).status to_be CellStatus::ACTIVE);
+        expect(intTable.at(4).value to_be 4);
+        expect(intTable.contains(11) to_be true);
+        expect(intTable.contains(4) to_be true);
+        expect(intTable.contains(0) to_be false);
+
+        // lowering the ratio below the current one purges right away
+        intTable.remove(4);
+        expect(intTable.tombstone_ratio() > 0);
+        intTable.max_tombstone_ratio(0.05);
+        expect(intTable.tombstone_ratio() to_be 0);
+        expect(intTable.at(4).status to_be CellStatus::EMPTY);
+        expect(intTable.contains(11) to_be true);
+    }
+
+    // insert/remove churn keeps the table at a constant size
+    {
+        HashTable<int> intTable;
+        intTable.max_tombstone_ratio(0.5); // leave it to inserts to clean up
+        for (int i = 0; i < 1000; i++) {
+            expect(intTable.insert(i) to_be true);
+            if (i >= 4) expect(intTable.remove(i - 4) to_be 1);
+        }
+        expect(intTable.table_size() to_be 11);
+        expect(intTable.size() to_be 4);
+        for (int i = 996; i < 1000; i++) expect(intTable.contains(i) to_be true);
+        for (int i = 0; i < 996; i++) assert(intTable.contains(i) to_be false);
+
+        HashTable<std::string> stringTable;
+        for (int i = 0; i < 500; i++) {
+            expect(stringTable.insert(std::to_string(i)) to_be true);
+            if (i % 2) expect(stringTable.remove(std::to_string(i - 1)) to_be 1);
+        }
+        expect(stringTable.size() to_be 250);
+        for (int i = 0; i < 500; i++) assert(stringTable.contains(std::to_string(i)) to_be (i % 2 == 1));
+    }
+
+    // rehash moves keys instead of copying them
+    {
+        HashTable<CopyCountedKey, CopyCountedKeyHash> table;
+        for (int i = 0; i < 5; i++) table.insert(CopyCountedKey(i));
+        CopyCountedKey::copies = 0;
+        table.insert(CopyCountedKey(5)); // causes a rehash
+        expect(table.table_size() to_be 23);
+        expect(CopyCountedKey::copies <= 1); // at most the copy made by insert itself
+        for (int i = 0; i <= 5; i++) expect(table.contains(CopyCountedKey(i)) to_be true);
+        expect(table.size() to_be 6);
+
+        HashTable<std::string> stringTable;
+        for (int i = 0; i < 200; i++) stringTable.insert(std::string(40, 'a' + i % 26) + std::to_string(i));
+        expect(stringTable.size() to_be 200);
+        for (int i = 0; i < 200; i++) assert(stringTable.contains(std::string(40, 'a' + i % 26) + std::to_string(i)) to_be true);
+    }
+
+    // power of two sizing
+    {
+        HashTable<int, std::hash<int>, std::equal_to<int>, PowerOfTwoSizing> intTable;
+        expect(intTable.table_size() to_be 16);
+        expect(intTable.position(1) to_be (PowerOfTwoSizing::mix(intTable.hash(1)) & 15));
+        expect(intTable.position(12345) to_be (PowerOfTwoSizing::mix(intTable.hash(12345)) & 15));
+        for (int i = 0; i < 8; i++) expect(intTable.insert(i) to_be true);
+        expect(intTable.table_size() to_be 16);
+        expect(intTable.insert(8) to_be true); // 9/16 > 0.5
+        expect(intTable.table_size() to_be 32);
+        for (int i = 0; i < 1000; i++) intTable.insert(i * 64); // multiples of a power of two are mixed across the table
+        expect(intTable.table_size() to_be 2048);
+        for (int i = 0; i < 1000; i++) assert(intTable.contains(i * 64) to_be true);
+        for (int i = 0; i < 1000; i++) expect(intTable.remove(i * 64) to_be 1);
+        for (int i = 1; i < 9; i++) expect(intTable.contains(i) to_be true);
+        expect(intTable.size() to_be 8);
+
+        HashTable<std::string, std::hash<std::string>, std::equal_to<std::string>, PowerOfTwoSizing> stringTable(100);
+        expect(stringTable.table_size() to_be 128);
+        for (int i = 0; i < 64; i++) stringTable.insert(std::to_string(i));
+        expect(stringTable.table_size() to_be 128);
+        for (int i = 0; i < 64; i++) expect(stringTable.contains(std::to_string(i)) to_be true);
+        expect(stringTable.contains("64") to_be false);
+    }
+
+    // prime fastmod sizing
+    {
+        HashTable<int, std::hash<int>, std::equal_to<int>, PrimeFastModSizing> intTable;
+        expect(intTable.table_size() to_be 11);
+        for (size_t i = 0; i < 11; i++) expect(intTable.position(i) to_be i); // same cells as hash % size for small hashes
+        expect(intTable.position(11) to_be 0);
+
+        HashTable<double, std::hash<double>, std::equal_to<double>, PrimeFastModSizing> doubleTable(23);
+        expect(doubleTable.position(34.5) to_be PrimeFastModSizing::fold(doubleTable.hash(34.5)) % 23);
+        expect(doubleTable.position(-273.3) to_be PrimeFastModSizing::fold(doubleTable.hash(-273.3)) % 23);
+        for (double d = 0.0; d < 500.0; d += 0.5) doubleTable.insert(d);
+        expect(doubleTable.size() to_be 1000);
+        expect(doubleTable.table_size() to_be 3203);
+        for (double d = 0.0; d < 500.0; d += 0.5) assert(doubleTable.contains(d) to_be true);
+        expect(doubleTable.contains(500.0) to_be false);
+    }
+
+    // HashMap - insert / find / operator[]
+    {
+        HashMap<std::string, int> map;
+        expect(map.is_empty() to_be true);
+        expect(map.find("one") to_be nullptr);
+        expect(map.insert("one", 1) to_be true);
+        expect(map.insert("one", 100) to_be false);
+        expect(map.size() to_be 1);
+        expect(map.find("one") not_to_be nullptr);
+        expect(*map.find("one") to_be 1);
+        expect(map.contains("one") to_be true);
+
+        map["two"] = 2;
+        expect(map.size() to_be 2);
+        expect(map["two"] to_be 2);
+        expect(map["three"] to_be 0); // default constructed on first access
+        expect(map.size() to_be 3);
+        map["three"] += 3;
+        expect(*map.find("three") to_be 3);
+
+        *map.find("one") = 11;
+        expect(map["one"] to_be 11);
+
+        const HashMap<std::string, int>& const_map = map;
+        expect(*const_map.find("two") to_be 2);
+        expect(const_map.find("four") to_be nullptr);
+
+        expect(map.remove("two") to_be 1);
+        expect(map.remove("two") to_be 0);
+        expect(map.find("two") to_be nullptr);
+        expect(map.size() to_be 2);
+
+        // growth keeps every key with its mapped value
+        HashMap<int, std::string> intMap;
+        for (int i = 0; i < 100; i++) intMap[i] = std::to_string(i);
+        expect(intMap.size() to_be 100);
+        for (int i = 0; i < 100; i++) assert(*intMap.find(i) to_be std::to_string(i));
+        for (int i = 0; i < 100; i += 2) intMap.remove(i);
+        for (int i = 0; i < 100; i++) assert((intMap.find(i) to_be nullptr) to_be (i % 2 == 0));
+    }
+
+    // HashMap - try_emplace / insert_or_assign
+    {
+        HashMap<int, std::string> map;
+        auto [value, inserted] = map.try_emplace(1, 3, 'x');
+        expect(inserted to_be true);
+        expect(*value to_be "xxx");
+        auto [existing, inserted_again] = map.try_emplace(1, 3, 'y');
+        expect(inserted_again to_be false);
+        expect(*existing to_be "xxx"); // mapped value is not constructed or changed when the key exists
+
+        auto [assigned, assign_inserted] = map.insert_or_assign(1, "assigned");
+        expect(assign_inserted to_be false);
+        expect(*assigned to_be "assigned");
+        expect(map.size() to_be 1);
+        auto [created, create_inserted] = map.insert_or_assign(2, "created");
+        expect(create_inserted to_be true);
+        expect(*created to_be "created");
+        expect(*map.find(2) to_be "created");
+        expect(map.size() to_be 2);
+
+        // emplace builds the whole pair, and leaves the existing one alone if the key is already there
+        auto [pair, emplaced] = map.emplace(3, "three");
+        expect(emplaced to_be true);
+        expect(pair->first to_be 3);
+        expect(pair->second to_be "three");
+        auto [kept, emplaced_again] = map.emplace(std::make_pair(3, std::string("other")));
+        expect(emplaced_again to_be false);
+        expect(kept->second to_be "three");
+        kept->second = "changed";
+        expect(*map.find(3) to_be "changed");
+        expect(map.size() to_be 3);
+
+        // find_iterator hands out an iterator to the entry, for erase()
+        auto found = map.find_iterator(2);
+        expect(found->second to_be "created");
+        expect((map.find_iterator(9) == map.end()) to_be true);
+        map.erase(found);
+        expect(map.find(2) to_be nullptr);
+        expect(map.size() to_be 2);
+    }
+
+    // heterogeneous lookup
+    {
+        HashTable<std::string, StringHash, std::equal_to<>> stringTable;
+        stringTable.insert("hello");
+        stringTable.insert("world");
+        std::string_view hello = "hello";
+        expect(stringTable.contains(hello) to_be true);
+        expect(stringTable.contains("world") to_be true);
+        expect(stringTable.contains(std::string_view("missing")) to_be false);
+        expect(stringTable.remove(std::string_view("world")) to_be 1);
+        expect(stringTable.contains("world") to_be false);
+        expect(stringTable.size() to_be 1);
+
+        HashMap<std::string, int, StringHash, std::equal_to<>> map;
+        map["key"] = 5;
+        expect(*map.find(std::string_view("key")) to_be 5);
+        expect(map.find("not a key") to_be nullptr);
+    }
+
+    // split layout
+    {
+        HashTable<int64_t, std::hash<int64_t>, std::equal_to<int64_t>, PrimeModuloSizing, SplitLayout> intTable;
+        expect(intTable.at(0).status to_be CellStatus::EMPTY);
+        expect(intTable.insert(0) to_be true);
+        expect(intTable.insert(11) to_be true); // collides with 0
+        expect(intTable.at(0).status to_be CellStatus::ACTIVE);
+        expect(intTable.at(0).value to_be 0);
+        expect(intTable.at(1).status to_be CellStatus::ACTIVE);
+        expect(intTable.at(1).value to_be 11);
+        expect(intTable.remove(0) to_be 1);
+        expect(intTable.at(0).status to_be CellStatus::DELETED);
+        expect(intTable.contains(11) to_be true);
+        expect_throw(intTable.at(11), std::out_of_range);
+        for (int64_t i = 100; i < 200; i++) intTable.insert(i);
+        for (int64_t i = 100; i < 200; i++) assert(intTable.contains(i) to_be true);
+        expect(intTable.size() to_be 101);
+
+        HashMap<std::string, int, std::hash<std::string>, std::equal_to<std::string>, PrimeModuloSizing, SplitLayout> map;
+        map["a"] = 1;
+        map["b"] = 2;
+        expect(*map.find("a") to_be 1);
+        expect(map.remove("a") to_be 1);
+        expect(map.find("a") to_be nullptr);
+        expect(map["b"] to_be 2);
+    }
+
+    // sentinel layout
+    {
+        using SentinelTable = HashTable<int64_t, std::hash<int64_t>, std::equal_to<int64_t>, PrimeModuloSizing, SentinelLayout<-1, -2>>;
+        SentinelTable intTable;
+        expect(intTable.at(0).status to_be CellStatus::EMPTY);
+        expect(intTable.at(0).value to_be -1);
+        expect(intTable.contains(-1) to_be false);
+        expect_throw(intTable.insert(-1), std::invalid_argument);
+        expect_throw(intTable.insert(-2), std::invalid_argument);
+        expect(intTable.size() to_be 0);
+
+        expect(intTable.insert(0) to_be true);
+        expect(intTable.insert(11) to_be true);
+        expect(intTable.at(0).status to_be CellStatus::ACTIVE);
+        expect(intTable.at(1).status to_be CellStatus::ACTIVE);
+        expect(intTable.at(1).value to_be 11);
+        expect(intTable.remove(0) to_be 1);
+        expect(intTable.at(0).status to_be CellStatus::DELETED);
+        expect(intTable.at(0).value to_be -2);
+        expect(intTable.contains(11) to_be true);
+        expect(intTable.contains(0) to_be false);
+        expect(intTable.insert(0) to_be true); // reuses the deleted cell
+        expect(intTable.at(0).status to_be CellStatus::ACTIVE);
+        expect(intTable.at(0).value to_be 0);
+
+        // tombstones are purged by rebuilding at the same size
+        SentinelTable churnTable;
+        for (int64_t i = 0; i < 1000; i++) {
+            expect(churnTable.insert(i) to_be true);
+            if (i >= 4) expect(churnTable.remove(i - 4) to_be 1);
+        }
+        expect(churnTable.table_size() to_be 11);
+        expect(churnTable.size() to_be 4);
+        for (int64_t i = 0; i < 1000; i++) assert(churnTable.contains(i) to_be (i >= 996));
+
+        HashMap<uint32_t, std::string, std::hash<uint32_t>, std::equal_to<uint32_t>, PrimeModuloSizing, SentinelLayout<0xFFFFFFFF, 0xFFFFFFFE>> map;
+        map[0] = "zero";
+        map[7] = "seven";
+        expect(*map.find(0) to_be "zero");
+        expect(map.remove(7) to_be 1);
+        expect(map.find(7) to_be nullptr);
+        expect_throw(map[0xFFFFFFFF], std::invalid_argument);
+        expect(map.size() to_be 1);
+    }
+
+    // robin hood probing
+    {
+        using RobinHoodTable = HashTable<int, std::hash<int>, std::equal_to<int>, PrimeModuloSizing, CellLayout, RobinHoodProbing>;
+        RobinHoodTable intTable;
+        expect(intTable.max_load_factor() to_be 0.875f);
+        expect(intTable.max_probe_length() to_be 0);
+
+        // 0, 11 and 22 share home cell 0, so 1 ends up two cells past its own
+        expect(intTable.insert(0) to_be true);
+        expect(intTable.insert(11) to_be true);
+        expect(intTable.insert(22) to_be true);
+        expect(intTable.insert(1) to_be true);
+        expect(intTable.at(3).value to_be 1);
+        expect(intTable.max_probe_length() to_be 3);
+        expect(intTable.insert(22) to_be false);
+
+        // 33 is further from home than 1 at cell 3, so takes that cell and 1 moves on
+        expect(*intTable.emplace(33).first to_be 33);
+        expect(intTable.position(33) to_be 3);
+        expect(intTable.at(4).value to_be 1);
+        expect(intTable.max_probe_length() to_be 4);
+        expect(intTable.position(44) to_be 4); // lookup stops at 1, which is closer to home than 44 would be
+
+        // backward shift delete, no tombstones
+        expect(intTable.remove(11) to_be 1);
+        expect(intTable.at(1).value to_be 22);
+        expect(intTable.at(2).value to_be 33);
+        expect(intTable.at(3).value to_be 1);
+        expect(intTable.at(4).status to_be CellStatus::EMPTY);
+        expect(intTable.remove(0) to_be 1);
+        expect(intTable.at(0).value to_be 22);
+        expect(intTable.at(1).value to_be 33);
+        expect(intTable.at(2).value to_be 1); // shifts into its home cell + 1
+        expect(intTable.at(3).status to_be CellStatus::EMPTY);
+        expect(intTable.tombstone_ratio() to_be 0);
+        expect(intTable.size() to_be 3);
+        expect(intTable.remove(0) to_be 0);
+        expect(intTable.contains(22) to_be true);
+        expect(intTable.contains(33) to_be true);
+        expect(intTable.contains(1) to_be true);
+        expect(intTable.contains(11) to_be false);
+
+        // runs at 0.9 load, churn leaves nothing behind
+        RobinHoodTable fullTable;
+        fullTable.max_load_factor(0.9f);
+        for (int i = 0; i < 10000; i++) assert(fullTable.insert(i * 7919) to_be true);
+        expect((fullTable.load_factor() <= 0.9f) to_be true);
+        expect((fullTable.load_factor() > 0.45f) to_be true);
+        for (int i = 0; i < 10000; i += 2) assert(fullTable.remove(i * 7919) to_be 1);
+        for (int i = 0; i < 10000; i++) assert(fullTable.contains(i * 7919) to_be (i % 2 == 1));
+        expect(fullTable.size() to_be 5000);
+        expect(fullTable.tombstone_ratio() to_be 0);
+        expect((fullTable.max_probe_length() < 64) to_be true);
+
+        HashMap<int64_t, std::string, std::hash<int64_t>, std::equal_to<int64_t>, PowerOfTwoSizing, SentinelLayout<-1, -2>, RobinHoodProbing> map;
+        for (int64_t i = 0; i < 100; i++) map[i] = std::to_string(i);
+        for (int64_t i = 0; i < 100; i += 3) expect(map.remove(i) to_be 1);
+        for (int64_t i = 0; i < 100; i++) assert((map.find(i) == nullptr) to_be (i % 3 == 0));
+        expect(*map.find(50) to_be "50");
+    }
+
+    // max load factor
+    {
+        HashTable<int> intTable;
+        expect(intTable.max_load_factor() to_be 0.5f);
+        expect_throw(intTable.max_load_factor(0.6f), std::invalid_argument); // quadratic probing over prime sizes
+        expect_throw(intTable.max_load_factor(0), std::invalid_argument);
+        for (int i = 0; i < 5; i++) intTable.insert(i);
+        intTable.max_load_factor(0.25f); // grows to fit
+        expect(intTable.table_size() to_be 23);
+        expect(intTable.max_tombstone_ratio() to_be 0.25f);
+        for (int i = 0; i < 5; i++) assert(intTable.contains(i) to_be true);
+
+        HashTable<int, std::hash<int>, std::equal_to<int>, PowerOfTwoSizing> powerTable;
+        expect_no_throw(powerTable.max_load_factor(0.9f));
+        for (int i = 0; i < 100; i++) assert(powerTable.insert(i) to_be true);
+        expect(powerTable.table_size() to_be 128);
+        for (int i = 0; i < 100; i++) assert(powerTable.contains(i) to_be true);
+        expect((powerTable.max_probe_length() >= 1) to_be true);
+
+        HashTable<int, std::hash<int>, std::equal_to<int>, PrimeModuloSizing, CellLayout, RobinHoodProbing> robinHoodTable;
+        expect_throw(robinHoodTable.max_load_factor(0.96f), std::invalid_argument);
+        expect_no_throw(robinHoodTable.max_load_factor(0.95f));
+    }
+
+    // batch operations
+    {
+        std::vector<int> keys;
+        for (int i = 0; i < 1000; i++) keys.push_back(i * 3);
+        HashTable<int> intTable;
+        expect(intTable.insert_batch(keys.data(), keys.size()) to_be 1000);
+        expect(intTable.insert_batch(keys.data(), 10) to_be 0); // already there
+        expect(intTable.size() to_be 1000);
+
+        std::vector<int> probes;
+        for (int i = 0; i < 3000; i++) probes.push_back(i);
+        std::unique_ptr<bool[]> results(new bool[probes.size()]);
+        expect(intTable.contains_batch(probes.data(), probes.size(), results.get()) to_be 1000);
+        for (size_t i = 0; i < probes.size(); i++) assert(results[i] to_be (i % 3 == 0));
+
+        expect(intTable.remove_batch(probes.data(), 1500) to_be 500);
+        expect(intTable.size() to_be 500);
+        expect(intTable.contains_batch(probes.data(), probes.size(), results.get()) to_be 500);
+        for (size_t i = 0; i < probes.size(); i++) assert(results[i] to_be (i % 3 == 0 && i >= 1500));
+        expect(intTable.contains_batch(probes.data(), 0, results.get()) to_be 0);
+
+        HashTable<int, std::hash<int>, std::equal_to<int>, PowerOfTwoSizing, SplitLayout, RobinHoodProbing> robinHoodTable;
+        expect(robinHoodTable.insert_batch(keys.data(), keys.size()) to_be 1000);
+        expect(robinHoodTable.remove_batch(keys.data(), 500) to_be 500);
+        expect(robinHoodTable.contains_batch(keys.data(), keys.size(), results.get()) to_be 500);
+        for (size_t i = 0; i < keys.size(); i++) assert(results[i] to_be (i >= 500));
+
+        HashMap<std::string, int> map;
+        map["a"] = 1;
+        map["b"] = 2;
+        std::string lookups[] = {"a", "c", "b"};
+        bool found[3];
+        expect(map.contains_batch(lookups, 3, found) to_be 2);
+        expect(found[1] to_be false);
+        expect(map.remove_batch(lookups, 3) to_be 2);
+        expect(map.is_empty() to_be true);
+    }
+
+    // allocators
+    {
+        CountingResource resource;
+        pmr::HashTable<int> intTable(11, &resource);
+        expect(intTable.get_allocator().resource() to_be &resource);
+        for (int i = 0; i < 1000; i++) intTable.insert(i);
+        for (int i = 0; i < 1000; i++) assert(intTable.contains(i) to_be true);
+        expect((resource.allocations > 0) to_be true);
+        intTable.make_empty();
+        expect(intTable.is_empty() to_be true);
+
+        pmr::HashTable<int64_t, std::hash<int64_t>, std::equal_to<int64_t>, PowerOfTwoSizing, SplitLayout, RobinHoodProbing> splitTable(16, &resource);
+        for (int64_t i = 0; i < 1000; i++) splitTable.insert(i);
+        for (int64_t i = 0; i < 1000; i += 2) splitTable.remove(i);
+        for (int64_t i = 0; i < 1000; i++) assert(splitTable.contains(i) to_be (i % 2 == 1));
+
+        pmr::HashMap<std::string, int> map(11, &resource);
+        size_t before = resource.allocations;
+        for (int i = 0; i < 100; i++) map[std::to_string(i)] = i;
+        expect((resource.allocations > before) to_be true);
+        expect(*map.find("42") to_be 42);
+
+        // a table on a monotonic buffer is dropped without freeing anything, the buffer goes all at once
+        size_t freed = resource.deallocations;
+        {
+            std::pmr::monotonic_buffer_resource arena(&resource);
+            {
+                pmr::HashTable<int> scratch(11, &arena);
+                for (int i = 0; i < 10000; i++) scratch.insert(i);
+                expect(scratch.size() to_be 10000);
+            }
+            expect(resource.deallocations to_be freed);
+        }
+        expect((resource.deallocations > freed) to_be true);
+    }
+
+    // incremental rehash
+    {
+        HashTable<int> table;
+        expect(table.incremental_rehash() to_be 0);
+        table.incremental_rehash(1);
+        expect(table.is_rehashing() to_be false);
+        expect(table.rehash_progress() to_be 1.0f);
+
+        // grows the way it always does, but only the first old cell moves in the insert that grew it
+        size_t size = table.table_size();
+        int next = 0;
+        while (table.table_size() == size) table.insert(next++);
+        expect(table.is_rehashing() to_be true);
+        expect((table.rehash_progress() < 1.0f) to_be true);
+        for (int i = 0; i < next; i++) assert(table.contains(i) to_be true);
+        expect(table.contains(next) to_be false);
+        expect(table.size() to_be static_cast<size_t>(next));
+
+        // keys still in the old cells can be found, reinserted and removed
+        expect(table.insert(0) to_be false);
+        expect(table.remove(1) to_be 1);
+        expect(table.contains(1) to_be false);
+        expect(table.remove(1) to_be 0);
+        expect(table.size() to_be static_cast<size_t>(next - 1));
+
+        // each insert or remove moves one more cell until the old ones are gone
+        float progress = table.rehash_progress();
+        table.insert(1000);
+        expect((table.rehash_progress() > progress) to_be true);
+        while (table.is_rehashing()) table.insert(next++);
+        expect(table.rehash_progress() to_be 1.0f);
+        for (int i = 0; i < next; i++) assert(table.contains(i) to_be (i != 1));
+        expect(table.contains(1000) to_be true);
+
+        // a second growth while rehashing finishes the first one before starting
+        table.incremental_rehash(2);
+        for (int i = next; i < 2000; i++) table.insert(i);
+        for (int i = 0; i < 2000; i++) assert(table.contains(i) to_be (i != 1));
+        table.finish_rehash();
+        expect(table.is_rehashing() to_be false);
+        expect(table.size() to_be 1999);
+
+        // a step of 0 goes back to rehashing all at once
+        size = table.table_size();
+        for (int i = 2000; table.table_size() == size; i++) table.insert(i);
+        table.incremental_rehash(0);
+        expect(table.is_rehashing() to_be false);
+        size = table.table_size();
+        for (int i = 10000; table.table_size() == size; i++) table.insert(i);
+        expect(table.is_rehashing() to_be false);
+
+        HashTable<int64_t, std::hash<int64_t>, std::equal_to<int64_t>, PowerOfTwoSizing, CellLayout, RobinHoodProbing> robinTable(16);
+        robinTable.incremental_rehash(4);
+        for (int64_t i = 0; i < 1000; i++) {
+            robinTable.insert(i);
+            if (i % 2 == 0) robinTable.remove(i / 2);
+        }
+        for (int64_t i = 0; i < 1000; i++) assert(robinTable.contains(i) to_be (i >= 500));
+        expect((robinTable.max_probe_length() <= robinTable.table_size()) to_be true);
+
+        HashMap<int, int, std::hash<int>, std::equal_to<int>, PowerOfTwoSizing, SentinelLayout<-1, -2>> map(16);
+        map.incremental_rehash(1);
+        for (int i = 0; i < 100; i++) map[i] = i * i;
+        expect(map.is_rehashing() to_be true);
+        for (int i = 0; i < 100; i++) assert(*map.find(i) to_be i * i);
+        map[3] = -3;
+        expect(*map.find(3) to_be -3);
+        map.make_empty();
+        expect(map.is_rehashing() to_be false);
+        expect(map.find(3) to_be nullptr);
+    }
+
+    // parallel rehash and bulk construction
+    {
+        // every key twice, duplicates are dropped
+        vector<int> keys;
+        for (int i = 0; i < 100000; i++) keys.push_back(i % 60000);
+        HashTable<int> table(keys.begin(), keys.end(), 4);
+        expect(table.size() to_be 60000);
+        expect((table.load_factor() <= table.max_load_factor()) to_be true);
+        for (int i = 0; i < 70000; i++) assert(table.contains(i) to_be (i < 60000));
+        expect(table.insert(5) to_be false);
+        expect(table.insert(60000) to_be true);
+
+        // non sequential keys that all share a factor, and keys that all collide
+        vector<int> strided, colliding;
+        for (int i = 0; i < 1000; i++) strided.push_back(i * 2001);
+        for (int i = 0; i < 300; i++) colliding.push_back(i % 200 * 3);
+        for (unsigned threads : {1u, 4u}) {
+            HashTable<int> stridedTable(strided.begin(), strided.end(), threads);
+            expect(stridedTable.size() to_be 1000);
+            for (int i = 0; i < 1000; i++) assert(stridedTable.contains(i * 2001) to_be true);
+            HashTable<int, CollidingHash> collidingTable(colliding.begin(), colliding.end(), threads);
+            expect(collidingTable.size() to_be 200);
+            for (int i = 0; i < 600; i++) assert(collidingTable.contains(i) to_be (i % 3 == 0));
+        }
+
+        HashTable<int> empty(keys.begin(), keys.begin(), 4);
+        expect(empty.is_empty() to_be true);
+
+        // growth spread over threads once the table is big enough
+        HashTable<int64_t, std::hash<int64_t>, std::equal_to<int64_t>, PowerOfTwoSizing, SplitLayout> grown;
+        expect(grown.rehash_threads() to_be 1);
+        expect_throw(grown.rehash_threads(0), std::invalid_argument);
+        grown.rehash_threads(4);
+        for (int64_t i = 0; i < 200000; i++) grown.insert(i * 7);
+        expect(grown.size() to_be 200000);
+        for (int64_t i = 0; i < 200000; i++) assert(grown.contains(i * 7) to_be true);
+        expect(grown.contains(3) to_be false);
+
+        // robin hood tables build on the calling thread, in the same order as inserting one by one
+        HashTable<int, std::hash<int>, std::equal_to<int>, PowerOfTwoSizing, CellLayout, RobinHoodProbing> robinTable(keys.begin(), keys.end(), 4);
+        expect(robinTable.size() to_be 60000);
+        for (int i = 0; i < 70000; i++) assert(robinTable.contains(i) to_be (i < 60000));
+
+        vector<int> reserved(50000, 1);
+        reserved.push_back(-1);
+        expect_throw((HashTable<int, std::hash<int>, std::equal_to<int>, PrimeModuloSizing, SentinelLayout<-1, -2>>(reserved.begin(), reserved.end(), 4)), std::invalid_argument);
+
+        vector<std::string> words;
+        for (int i = 0; i < 50000; i++) words.push_back(std::to_string(i % 1000));
+        HashTable<std::string> wordTable(words.begin(), words.end(), 4);
+        expect(wordTable.size() to_be 1000);
+        expect(wordTable.contains("999") to_be true);
+    }
+
+    // cached hashes
+    {
+        // each key is hashed once, on insert. growing and purging read the stored hashes
+        CountingStringHash::calls = 0;
+        HashTable<std::string, CountingStringHash, std::equal_to<std::string>, PrimeModuloSizing, CachedHashLayout<>> table;
+        for (int i = 0; i < 1000; i++) table.insert(std::to_string(i));
+        expect(CountingStringHash::calls to_be 1000);
+        for (int i = 0; i < 1000; i += 2) table.remove(std::to_string(i));
+        for (int i = 0; i < 200; i++) table.insert("x" + std::to_string(i));
+        expect(CountingStringHash::calls to_be 1700);
+        for (int i = 0; i < 1000; i++) assert(table.contains(std::to_string(i)) to_be (i % 2 == 1));
+        for (int i = 0; i < 200; i++) assert(table.contains("x" + std::to_string(i)) to_be true);
+
+        // robin hood displacement comes from the stored hashes too, which move with their values
+        CountingStringHash::calls = 0;
+        HashTable<std::string, CountingStringHash, std::equal_to<std::string>, PowerOfTwoSizing, CachedHashLayout<SplitLayout>, RobinHoodProbing> robinTable(16);
+        for (int i = 0; i < 1000; i++) robinTable.insert(std::to_string(i));
+        expect(CountingStringHash::calls to_be 1000);
+        for (int i = 0; i < 1000; i += 2) robinTable.remove(std::to_string(i));
+        for (int i = 0; i < 1000; i++) assert(robinTable.contains(std::to_string(i)) to_be (i % 2 == 1));
+
+        // incremental and parallel rehashes carry the hashes across as well
+        HashTable<int, std::hash<int>, std::equal_to<int>, PowerOfTwoSizing, CachedHashLayout<>> grown;
+        grown.incremental_rehash(8);
+        for (int i = 0; i < 1000; i++) grown.insert(i);
+        grown.incremental_rehash(0);
+        grown.rehash_threads(4);
+        for (int i = 1000; i < 100000; i++) grown.insert(i);
+        for (int i = 0; i < 100000; i++) assert(grown.contains(i) to_be true);
+
+        HashMap<std::string, int, std::hash<std::string>, std::equal_to<std::string>, PrimeModuloSizing, CachedHashLayout<>> map;
+        for (int i = 0; i < 100; i++) map[std::to_string(i)] = i;
+        expect(*map.find("42") to_be 42);
+        expect(map.find("100") to_be nullptr);
+    }
+
+    // precomputed hashes
+    {
+        // a key parsed out of a buffer is looked up and inserted without building a std::string unless it is new
+        HashTable<std::string, StringHash, std::equal_to<>> table;
+        std::string_view parsed = "parsed";
+        size_t hash_value = StringHash{}(parsed);
+        expect(table.insert(parsed, hash_value) to_be true);
+        expect(table.insert(parsed) to_be false);
+        expect(table.insert(std::string("parsed"), hash_value) to_be false);
+        expect(table.contains(parsed, hash_value) to_be true);
+        expect(table.contains(std::string("parsed"), hash_value) to_be true);
+        expect(table.position(parsed, hash_value) to_be table.position("parsed"));
+
+        // hashes kept from one table are good for another with the same Hash
+        HashTable<std::string, StringHash, std::equal_to<>> other;
+        std::vector<size_t> hashes;
+        for (int i = 0; i < 100; i++) {
+            std::string key = std::to_string(i);
+            hashes.push_back(StringHash{}(key));
+            table.insert(key, hashes.back());
+        }
+        for (int i = 0; i < 100; i++) other.insert(std::to_string(i), hashes[i]);
+        for (int i = 0; i < 100; i++) assert(other.contains(std::to_string(i), hashes[i]) to_be true);
+        expect(table.remove(parsed, hash_value) to_be 1);
+        expect(table.contains(parsed, hash_value) to_be false);
+        expect(table.remove("parsed", hash_value) to_be 0);
+        expect(table.size() to_be 100);
+
+        HashTable<int> ints;
+        size_t seven = std::hash<int>{}(7);
+        expect(ints.insert(7, seven) to_be true);
+        expect(ints.contains(7, seven) to_be true);
+        expect(ints.remove(7, seven) to_be 1);
+        expect(ints.is_empty() to_be true);
+
+        HashMap<std::string, int, StringHash, std::equal_to<>> map;
+        map["key"] = 5;
+        expect(*map.find(std::string_view("key"), StringHash{}("key")) to_be 5);
+        expect(*map.find(std::string("key"), StringHash{}("key")) to_be 5);
+        expect(map.find("missing", StringHash{}("missing")) to_be nullptr);
+    }
+
+    // probing policies
+    {
+        HashTable<int, std::hash<int>, std::equal_to<int>, PowerOfTwoSizing, CellLayout, TriangularProbing> triangularTable(16);
+        HashTable<int, std::hash<int>, std::equal_to<int>, PrimeModuloSizing, CellLayout, LinearProbing> linearTable;
+        HashTable<int, std::hash<int>, std::equal_to<int>, PowerOfTwoSizing, SplitLayout, LinearProbing> linearPowerTable(16);
+        HashTable<int, std::hash<int>, std::equal_to<int>, PrimeModuloSizing, CellLayout, DoubleHashProbing> doubleTable;
+        HashTable<int, std::hash<int>, std::equal_to<int>, PowerOfTwoSizing, CachedHashLayout<>, DoubleHashProbing> doublePowerTable(16);
+
+        // every sequence reaches every cell, so all of them can run nearly full
+        triangularTable.max_load_factor(0.9f);
+        linearTable.max_load_factor(0.9f);
+        doubleTable.max_load_factor(0.9f);
+        expect_throw(linearTable.max_load_factor(0.96f), std::invalid_argument);
+
+        auto exercise = [](auto& table) {
+            for (int i = 0; i < 2000; i++) table.insert(i);
+            for (int i = 0; i < 2000; i += 2) table.remove(i);
+            for (int i = 0; i < 500; i += 2) table.insert(i); // reuses tombstones
+            for (int i = 0; i < 2000; i++) assert(table.contains(i) to_be (i % 2 == 1 || i < 500));
+            expect(table.size() to_be 1250);
+            for (int i = 0; i < 2000; i++) assert((table.position(i) < table.table_size()) to_be true);
+            expect((table.max_probe_length() >= 1) to_be true);
+        };
+        exercise(triangularTable);
+        exercise(linearTable);
+        exercise(linearPowerTable);
+        exercise(doubleTable);
+        exercise(doublePowerTable);
+
+        // every key on the same home cell still ends, whatever the sequence
+        HashTable<int, CollidingHash, std::equal_to<int>, PowerOfTwoSizing, CellLayout, TriangularProbing> collidingTriangular(16);
+        HashTable<int, CollidingHash, std::equal_to<int>, PrimeModuloSizing, CellLayout, LinearProbing> collidingLinear;
+        HashTable<int, CollidingHash, std::equal_to<int>, PrimeModuloSizing, CellLayout, DoubleHashProbing> collidingDouble;
+        HashTable<int, CollidingHash> collidingQuadratic;
+        for (int i = 0; i < 200; i++) {
+            collidingTriangular.insert(i);
+            collidingLinear.insert(i);
+            collidingDouble.insert(i);
+            collidingQuadratic.insert(i);
+        }
+        for (int i = 0; i < 200; i += 3) {
+            collidingTriangular.remove(i);
+            collidingLinear.remove(i);
+            collidingDouble.remove(i);
+            collidingQuadratic.remove(i);
+        }
+        for (int i = 0; i < 300; i++) {
+            assert(collidingTriangular.contains(i) to_be (i < 200 && i % 3 != 0));
+            assert(collidingLinear.contains(i) to_be (i < 200 && i % 3 != 0));
+            assert(collidingDouble.contains(i) to_be (i < 200 && i % 3 != 0));
+            assert(collidingQuadratic.contains(i) to_be (i < 200 && i % 3 != 0));
+        }
+    }
+
+    // runtime stats
+    {
+        HashTable<int, std::hash<int>, std::equal_to<int>, PrimeModuloSizing, CellLayout, QuadraticProbing, std::allocator<int>, CollectStats> table;
+        for (int i = 0; i < 100; i++) table.insert(i);
+        for (int i = 0; i < 100; i++) assert(table.contains(i) to_be true);
+        for (int i = 100; i < 150; i++) assert(table.contains(i) to_be false);
+
+        TableStats stats = table.stats();
+        expect(stats.hits to_be 100);
+        expect((stats.rehashes >= 1) to_be true);
+        expect(stats.misses to_be 150); // every insert, the second probe after growing isn't a search of its own
+        expect((stats.average_hit_probes() >= 1.0) to_be true);
+        expect((stats.max_hit_probes >= 1) to_be true);
+        expect((stats.rehash_seconds >= 0.0) to_be true);
+        expect(stats.bytes_allocated to_be table.table_size() * sizeof(OpenAddressingCell<int>));
+        size_t keys = 0;
+        for (size_t count : stats.chain_lengths) keys += count;
+        expect(keys to_be 100);
+        expect(stats.chain_lengths.size() to_be table.max_probe_length() + 1);
+
+        for (int i = 0; i < 10; i++) table.remove(i);
+        stats = table.stats();
+        expect(stats.tombstones to_be 10);
+        expect(stats.tombstone_ratio to_be table.tombstone_ratio());
+
+        std::stringstream ss;
+        stats.print_prometheus(ss, "users");
+        expect(ss.str().find("# TYPE users_searches_total counter") != std::string::npos);
+        expect(ss.str().find("users_searches_total{result=\"hit\"} 110") != std::string::npos);
+        expect(ss.str().find("users_chain_length_bucket{le=\"+Inf\"} 90") != std::string::npos);
+        expect(ss.str().find("users_tombstones 10") != std::string::npos);
+
+        // copies keep the counters, reset_stats() clears them
+        auto copy = table;
+        expect(copy.stats().hits to_be 110);
+        table.reset_stats();
+        expect(table.stats().hits to_be 0);
+        expect(table.stats().misses to_be 0);
+        expect(table.stats().rehashes to_be 0);
+        expect(table.stats().tombstones to_be 10);
+
+        // one search per lookup while keys are split between the old and new tables of an incremental rehash
+        HashTable<int, std::hash<int>, std::equal_to<int>, PrimeModuloSizing, CellLayout, QuadraticProbing, std::allocator<int>, CollectStats> incremental;
+        incremental.incremental_rehash(1);
+        int next = 0;
+        for (size_t size = incremental.table_size(); incremental.table_size() == size;) incremental.insert(next++);
+        expect(incremental.is_rehashing() to_be true);
+        incremental.reset_stats();
+        for (int i = 0; i < next; i++) assert(incremental.contains(i) to_be true);
+        expect(incremental.contains(next) to_be false);
+        expect(incremental.find(next) == incremental.end());
+        expect(incremental.stats().hits to_be static_cast<size_t>(next));
+        expect(incremental.stats().misses to_be 2);
+        expect(incremental.is_rehashing() to_be true);
+
+        // a hash that sends every key to one cell shows up as long probes
+        HashTable<int, CollidingHash, std::equal_to<int>, PrimeModuloSizing, CellLayout, QuadraticProbing, std::allocator<int>, CollectStats> colliding;
+        for (int i = 0; i < 20; i++) colliding.insert(i);
+        expect(colliding.contains(20) to_be false);
+        expect((colliding.stats().max_miss_probes > 20) to_be true);
+        expect(colliding.stats().chain_lengths.size() to_be 21);
+
+        HashMap<int, int, std::hash<int>, std::equal_to<int>, PowerOfTwoSizing, SplitLayout, RobinHoodProbing, std::allocator<std::pair<const int, int>>,
+                CollectStats> map;
+        for (int i = 0; i < 50; i++) map[i] = i;
+        expect(*map.find(7) to_be 7);
+        expect((map.stats().hits >= 1) to_be true);
+        expect(map.stats().bytes_allocated to_be map.table_size() * (sizeof(CellStatus) + sizeof(std::pair<int, int>)));
+    }
+
+    // iterators
+    {
+        HashTable<int> table;
+        for (int i = 0; i < 100; i++) table.insert(i);
+        std::vector<int> seen(100, 0);
+        for (int key : table) seen[key]++;
+        for (int i = 0; i < 100; i++) assert(seen[i] to_be 1);
+        expect(std::distance(table.begin(), table.end()) to_be 100);
+
+        auto found = table.find(42);
+        expect((found != table.end()) to_be true);
+        expect(*found to_be 42);
+        expect((table.find(100) == table.end()) to_be true);
+
+        // erasing while walking keeps the rest of the walk valid
+        for (auto it = table.begin(); it != table.end(); ) {
+            if (*it % 2 == 0) it = table.erase(it);
+            else ++it;
+        }
+        expect(table.size() to_be 50);
+        for (int i = 0; i < 100; i++) assert(table.contains(i) to_be (i % 2 == 1));
+
+        int sum = 0;
+        table.for_each([&sum](int key) { sum += key; });
+        expect(sum to_be 2500);
+
+        std::vector<int> keys = table.extract_all();
+        expect(keys.size() to_be 50);
+        expect(table.is_empty() to_be true);
+        expect((table.begin() == table.end()) to_be true);
+        sum = 0;
+        for (int key : keys) sum += key;
+        expect(sum to_be 2500);
+
+        // map iterators reach the mapped values. robin hood erase shifts values back into the erased cell
+        HashMap<int, int, std::hash<int>, std::equal_to<int>, PowerOfTwoSizing, CellLayout, RobinHoodProbing> map;
+        for (int i = 0; i < 200; i++) map[i] = i;
+        for (auto&& [key, value] : map) value = key * 2;
+        for (int i = 0; i < 200; i++) assert(*map.find(i) to_be i * 2);
+        // keys are read only through them, it->first = ... doesn't compile
+        expect((assignable_key<std::vector<std::pair<int, int>>::iterator>::value to_be true));
+        expect((assignable_key<decltype(map)::iterator>::value to_be false));
+        expect((assignable_key<decltype(map)::const_iterator>::value to_be false));
+        expect((assignable_key<decltype(map.emplace(1, 2).first)>::value to_be false));
+        std::pair<int, int> copied = *map.begin();
+        expect(copied.second to_be copied.first * 2);
+        for (auto it = map.begin(); it != map.end(); ) {
+            if (it->first % 3 == 0) it = map.erase(it);
+            else ++it;
+        }
+        expect(map.size() to_be 133);
+        for (int i = 0; i < 200; i++) assert((map.find(i) != nullptr) to_be (i % 3 != 0));
+
+        // a cluster homed at the second to last cell wraps around to the start of the table. erasing its first two
+        // values shifts the ones at the start, visited already, back to the end, and the walk must not see them again
+        for (bool erase_all : {false, true}) {
+            HashTable<int, std::hash<int>, std::equal_to<int>, PrimeModuloSizing, CellLayout, RobinHoodProbing> wrapping(11);
+            int size = static_cast<int>(wrapping.table_size());
+            for (int i = 0; i < 6; i++) wrapping.insert(size - 2 + i * size);
+            expect(wrapping.table_size() to_be static_cast<size_t>(size));
+            expect(*wrapping.begin() to_be size - 2 + 2 * size);
+            std::vector<int> visits(6, 0);
+            for (auto it = wrapping.begin(); it != wrapping.end(); ) {
+                int i = *it / size;
+                visits[i]++;
+                if (erase_all || i < 2) it = wrapping.erase(it);
+                else ++it;
+            }
+            for (int i = 0; i < 6; i++) assert(visits[i] to_be 1);
+            expect(wrapping.size() to_be (erase_all ? 0u : 4u));
+            for (int i = 2; i < 6; i++) assert(wrapping.contains(size - 2 + i * size) to_be !erase_all);
+        }
+
+        // mid rehash the walk covers the values not migrated yet too
+        HashTable<std::string> incremental;
+        incremental.incremental_rehash(1);
+        for (int i = 0; i < 100; i++) incremental.insert(std::to_string(i));
+        expect(incremental.is_rehashing() to_be true);
+        size_t count = 0;
+        incremental.for_each([&count](const std::string&) { count++; });
+        expect(count to_be 100);
+        expect(std::distance(incremental.begin(), incremental.end()) to_be 100);
+        for (int i = 0; i < 100; i++) assert((incremental.find(std::to_string(i)) != incremental.end()) to_be true);
+        for (int i = 0; i < 100; i++) incremental.erase(incremental.find(std::to_string(i)));
+        expect(incremental.is_empty() to_be true);
+        expect((incremental.begin() == incremental.end()) to_be true);
+    }
+
+    // snapshots
+    {
+        const char* path = "hashtable_snapshot_test.bin";
+        HashTable<uint64_t> table;
+        for (uint64_t i = 0; i < 1000; i++) table.insert(i * 7919);
+        for (uint64_t i = 0; i < 1000; i += 4) table.remove(i * 7919); // the snapshot keeps the tombstones
+        table.save(path);
+
+        auto loaded = HashTable<uint64_t>::load(path);
+        expect(loaded.size() to_be 750);
+        expect(loaded.table_size() to_be table.table_size());
+        expect(loaded.tombstone_ratio() to_be table.tombstone_ratio());
+        for (uint64_t i = 0; i < 1000; i++) assert(loaded.contains(i * 7919) to_be (i % 4 != 0));
+        expect(loaded.insert(1) to_be true); // a loaded table is an ordinary one
+        expect(loaded.contains(1) to_be true);
+
+        {
+            auto mapped = HashTable<uint64_t>::load_mmap(path);
+            expect(mapped.size() to_be 750);
+            expect(mapped.table_size() to_be table.table_size());
+            for (uint64_t i = 0; i < 1000; i++) assert(mapped.contains(i * 7919) to_be (i % 4 != 0));
+            expect(mapped.contains(1) to_be false);
+            size_t count = 0;
+            mapped.for_each([&count](uint64_t) { count++; });
+            expect(count to_be 750);
+        }
+
+        // another table type, a damaged file and a missing one are all refused
+        expect_throw(HashTable<uint32_t>::load(path), std::runtime_error);
+        expect_throw((HashTable<uint64_t, std::hash<uint64_t>, std::equal_to<uint64_t>, PowerOfTwoSizing>::load(path)), std::runtime_error);
+        {
+            std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+            file.seekg(200);
+            char byte = static_cast<char>(file.get());
+            file.seekp(200);
+            file.put(static_cast<char>(byte ^ 1));
+        }
+        expect_throw(HashTable<uint64_t>::load(path), std::runtime_error);
+        expect_throw(HashTable<uint64_t>::load_mmap(path, true), std::runtime_error);
+        expect(HashTable<uint64_t>::load_mmap(path).size() to_be 750); // unverified by default
+        std::remove(path);
+        expect_throw(HashTable<uint64_t>::load(path), std::runtime_error);
+        expect_throw(HashTable<uint64_t>::load_mmap(path), std::runtime_error);
+
+        // maps, the other layouts and probing policies
+        HashMap<uint64_t, double, std::hash<uint64_t>, std::equal_to<uint64_t>, PowerOfTwoSizing, CachedHashLayout<SplitLayout>, RobinHoodProbing> map;
+        for (uint64_t i = 0; i < 500; i++) map[i] = i / 2.0;
+        map.save(path);
+        {
+            auto mapped = decltype(map)::load_mmap(path, true);
+            for (uint64_t i = 0; i < 500; i++) assert(mapped.find(i)->second to_be i / 2.0);
+            expect((mapped.find(500) == nullptr) to_be true);
+        }
+        auto loaded_map = decltype(map)::load(path);
+        for (uint64_t i = 0; i < 500; i++) assert(*loaded_map.find(i) to_be i / 2.0);
+        expect(loaded_map.max_probe_length() to_be map.max_probe_length());
+
+        // a rehash in progress is finished before saving
+        HashTable<int64_t, std::hash<int64_t>, std::equal_to<int64_t>, PrimeModuloSizing, SentinelLayout<-1, -2>, LinearProbing> sentinel;
+        sentinel.incremental_rehash(1);
+        for (int64_t i = 0; i < 300; i++) sentinel.insert(i);
+        expect(sentinel.is_rehashing() to_be true);
+        sentinel.save(path);
+        expect(sentinel.is_rehashing() to_be false);
+        {
+            auto mapped = decltype(sentinel)::load_mmap(path);
+            for (int64_t i = 0; i < 300; i++) assert(mapped.contains(i) to_be true);
+            expect(mapped.contains(-1) to_be false);
+            expect(mapped.contains(300) to_be false);
+        }
+        std::remove(path);
+    }
+
+    // streaming
+    {
+        HashTable<std::string> table;
+        for (int i = 0; i < 2000; i++) table.insert("key " + std::to_string(i) + std::string(i % 40, 'x'));
+        for (int i = 0; i < 2000; i += 3) table.remove("key " + std::to_string(i) + std::string(i % 40, 'x'));
+        std::stringstream stream;
+        table.write(stream);
+        stream << "after";
+        auto loaded = HashTable<std::string>::read(stream);
+        expect(loaded.size() to_be table.size());
+        for (int i = 0; i < 2000; i++) assert(loaded.contains("key " + std::to_string(i) + std::string(i % 40, 'x')) to_be (i % 3 != 0));
+        expect(loaded.insert("new") to_be true); // a loaded table is an ordinary one
+        expect(loaded.insert("key 1x") to_be false);
+        std::string rest;
+        stream >> rest; // what follows the table in the stream is left for the caller
+        expect(rest to_be "after");
+
+        // maps, and a table in the middle of an incremental rehash
+        HashMap<std::string, int, std::hash<std::string>, std::equal_to<std::string>, PowerOfTwoSizing, CachedHashLayout<>, RobinHoodProbing> map;
+        map.incremental_rehash(1);
+        for (int i = 0; i < 500; i++) map[std::to_string(i)] = i;
+        expect(map.is_rehashing() to_be true);
+        std::stringstream map_stream;
+        map.write(map_stream);
+        auto loaded_map = decltype(map)::read(map_stream);
+        expect(loaded_map.size() to_be 500);
+        for (int i = 0; i < 500; i++) assert(*loaded_map.find(std::to_string(i)) to_be i);
+
+        // a stream for another Hash, one cut short and one that isn't a table are refused
+        HashTable<int> ints;
+        for (int i = 0; i < 100; i++) ints.insert(i);
+        std::stringstream int_stream;
+        ints.write(int_stream);
+        std::string written = int_stream.str();
+        expect_throw((HashTable<int, CollidingHash>::read(int_stream)), std::runtime_error);
+        std::stringstream cut(written.substr(0, written.size() / 2));
+        expect_throw(HashTable<int>::read(cut), std::runtime_error);
+        std::stringstream text("not a table at all");
+        expect_throw(HashTable<int>::read(text), std::runtime_error);
+        std::stringstream whole(written);
+        expect(HashTable<int>::read(whole).size() to_be 100);
+    }
+
+    // capacity planning
+    {
+        HashTable<int> table;
+        table.reserve(1000);
+        size_t reserved = table.table_size();
+        expect((reserved >= 2000) to_be true);
+        for (int i = 0; i < 1000; i++) table.insert(i);
+        expect(table.table_size() to_be reserved); // no rehash along the way
+        table.reserve(10); // never shrinks
+        expect(table.table_size() to_be reserved);
+
+        for (int i = 0; i < 900; i++) table.remove(i);
+        table.shrink_to_fit();
+        expect((table.table_size() < reserved) to_be true);
+        expect(table.tombstone_ratio() to_be 0);
+        for (int i = 0; i < 1000; i++) assert(table.contains(i) to_be (i >= 900));
+
+        // reserve goes by the table's own max load factor and sizing
+        HashTable<int, std::hash<int>, std::equal_to<int>, PowerOfTwoSizing, CellLayout, RobinHoodProbing> robin;
+        robin.reserve(7000);
+        expect(robin.table_size() to_be 8192);
+        for (int i = 0; i < 7000; i++) robin.insert(i);
+        expect(robin.table_size() to_be 8192);
+
+        // prime sizes, so non sequential keys sharing a factor still reach enough cells
+        HashTable<int> strided;
+        for (int i = 0; i < 400; i++) strided.insert(i * 2001);
+        strided.reserve(1000);
+        for (int i = 0; i < 400; i++) assert(strided.contains(i * 2001) to_be true);
+        HashTable<int> spaced;
+        spaced.reserve(1000);
+        size_t spaced_size = spaced.table_size();
+        for (int i = 0; i < 1000; i++) spaced.insert(i * 69);
+        expect(spaced.table_size() to_be spaced_size);
+        for (int i = 0; i < 900; i++) spaced.remove(i * 69);
+        spaced.shrink_to_fit();
+        for (int i = 0; i < 1000; i++) assert(spaced.contains(i * 69) to_be (i >= 900));
+        for (int i = 0; i < 900; i++) spaced.insert(i * 2003);
+        expect(spaced.size() to_be 1000);
+
+        // a map built from a range is sized once, duplicate keys are dropped
+        std::vector<std::pair<int, std::string>> pairs;
+        for (int i = 0; i < 1000; i++) pairs.emplace_back(i % 500, std::to_string(i));
+        HashMap<int, std::string> map(pairs.begin(), pairs.end());
+        expect(map.size() to_be 500);
+        for (int i = 0; i < 500; i++) assert((*map.find(i) == std::to_string(i) || *map.find(i) == std::to_string(i + 500)) to_be true);
+    }
+
     // print table
     {
       HashTable<int> intTable;
@@ -387,6 +1515,12 @@ int main() {
       intTable.print_table(ss);
       std::string expected = "2: 2\n3: 3\n";
       expect(ss.str() to_be expected);
+
+      HashMap<int, std::string> map;
+      map[2] = "two";
+      std::stringstream mapss;
+      map.print_table(mapss);
+      expect(mapss.str() to_be "2: 2 => two\n");
     }
 
 
@@ -494,4 +1628,4 @@ int main() {
     // }
     
     return 0;
-}
\ No newline at end of file
+}
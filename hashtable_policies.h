@@ -0,0 +1,575 @@
+/*
+ *  Policies and helpers shared by both hashtable implementations.
+ *
+ *  A sizing policy decides which table sizes are used and how a hash value is reduced to an index for the current size.
+ *  The table calls resize() whenever its size changes. valid_size() is the size used when a caller asks for one,
+ *  fit_size() the size used when one is worked out from a count of keys, and next_size() the size to grow to.
+ *
+ *  PrimeModuloSizing   - hash % size over prime sizes. the original behaviour and the default
+ *  PowerOfTwoSizing    - mixes the hash then masks it, sizes are powers of two. no division anywhere
+ *  PrimeFastModSizing  - prime sizes, but the modulo is done with a precomputed reciprocal (Lemire's fastmod) on the
+ *                        hash folded to 32 bits, so no div instruction. sizes are limited to 32 bits
+*/
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <istream>
+#include <ostream>
+
+// what each cell/bucket node of a table stores. HashTable stores the key itself, HashMap a key/mapped value pair
+template <class Key>
+struct SetSlot {
+    using value_type = Key;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    // values can be copied as raw bytes, as snapshots do
+    static constexpr bool trivially_copyable = std::is_trivially_copyable_v<Key>;
+    static const Key& key(const value_type& value) { return value; }
+    static Key& key(value_type& value) { return value; }
+    static void print(std::ostream& os, const value_type& value) { os << value; }
+};
+
+// a map entry as the map's iterators hand it out, in place of a std::pair<Key, T>&. first is read only, so the key a
+// value was placed by can't be changed under the table, second is the mapped value
+template <class Key, class T>
+struct MapReference {
+    const Key& first;
+    T& second;
+
+    template <class Pair>
+    MapReference(Pair& pair) : first{pair.first}, second{pair.second} {}
+    operator std::pair<Key, std::remove_const_t<T>>() const { return {first, second}; }
+};
+
+// what operator-> of an iterator returns when its reference is a proxy such as MapReference: the proxy, kept alive
+// for the member access
+template <class Reference>
+struct ArrowProxy {
+    Reference reference;
+    const Reference* operator->() const { return &reference; }
+};
+
+template <class Key, class T>
+struct MapSlot {
+    using value_type = std::pair<Key, T>;
+    using reference = MapReference<Key, T>;
+    using const_reference = MapReference<Key, const T>;
+    // std::pair itself never is, its assignment is user provided, but a pair of trivially copyable types is
+    static constexpr bool trivially_copyable = std::is_trivially_copyable_v<Key> && std::is_trivially_copyable_v<T>;
+    static const Key& key(const value_type& value) { return value.first; }
+    static Key& key(value_type& value) { return value.first; }
+    static void print(std::ostream& os, const value_type& value) { os << value.first << " => " << value.second; }
+};
+
+// Allocator rebound to allocate T, for the arrays and nodes a table builds out of its Allocator
+template <class Allocator, class T>
+using rebind_alloc_t = typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+
+// true when both Hash and KeyEqual declare is_transparent, which allows lookups with any type they accept (for
+// example a std::string_view into a table of std::string) without first building a Key
+template <class Hash, class KeyEqual, class = void>
+struct is_transparent_lookup : std::false_type {};
+
+template <class Hash, class KeyEqual>
+struct is_transparent_lookup<Hash, KeyEqual, std::void_t<typename Hash::is_transparent, typename KeyEqual::is_transparent>>
+    : std::true_type {};
+
+// batch operations hash this many keys and prefetch their cells/buckets before resolving any of them, so the cache
+// misses of a whole group overlap instead of being waited on one at a time
+constexpr size_t prefetch_group_size = 16;
+
+// hint that address will be read soon. no-op where the builtin isn't available
+inline void prefetch(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address);
+#else
+    (void)address;
+#endif
+}
+
+// parallel rehash and bulk construction split their work into ranges of at least this many cells/keys, smaller ranges
+// cost more to start a thread for than they save
+constexpr size_t parallel_grain = size_t{1} << 14;
+
+inline unsigned default_thread_count() {
+    unsigned threads = std::thread::hardware_concurrency();
+    return threads ? threads : 1;
+}
+
+// calls body(begin, end) on contiguous ranges covering [0, count), one range per thread on up to threads threads, the
+// calling thread being one of them. returns once every range is done, rethrowing the first exception any of them threw
+template <class Body>
+void parallel_for(size_t count, unsigned threads, Body body) {
+    size_t workers = std::max<size_t>(1, std::min<size_t>(threads, count / parallel_grain));
+    if (workers == 1) {
+        body(size_t{0}, count);
+        return;
+    }
+
+    std::vector<std::exception_ptr> errors(workers);
+    auto run = [&](size_t worker) {
+        try {
+            body(count * worker / workers, count * (worker + 1) / workers);
+        } catch (...) {
+            errors[worker] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> pool;
+    pool.reserve(workers - 1);
+    for (size_t worker = 1; worker < workers; worker++) pool.emplace_back(run, worker);
+    run(0);
+    for (std::thread& thread : pool) thread.join();
+    for (std::exception_ptr& error : errors)
+        if (error) std::rethrow_exception(error);
+}
+
+// high 64 bits of the 128 bit product a * b
+inline uint64_t mulhi64(uint64_t a, uint64_t b) {
+#ifdef __SIZEOF_INT128__
+    __extension__ typedef unsigned __int128 uint128;
+    return static_cast<uint64_t>((static_cast<uint128>(a) * b) >> 64);
+#else
+    uint64_t a_lo = a & 0xFFFFFFFF, a_hi = a >> 32, b_lo = b & 0xFFFFFFFF, b_hi = b >> 32;
+    uint64_t lo_lo = a_lo * b_lo, hi_lo = a_hi * b_lo, lo_hi = a_lo * b_hi, hi_hi = a_hi * b_hi;
+    uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+    return hi_hi + (hi_lo >> 32) + (cross >> 32);
+#endif
+}
+
+class PrimeModuloSizing {
+    private:
+        size_t _size = 1;
+
+        // Primality test in C-family on Wikipedia: https://en.wikipedia.org/wiki/Primality_test#C,_C++,_C#_&_D - this is not my algorithm
+        static bool is_prime(size_t n) {
+            if (n == 2 || n == 3) return true;
+            if (n <= 1 || n % 2 == 0 || n % 3 == 0) return false;
+            for (size_t i = 5; i * i <= n; i += 6)
+                if (n % i == 0 || n % (i + 2) == 0) return false;
+
+            return true;
+        }
+
+    public:
+        static constexpr bool power_of_two = false;
+
+        // size actually used when a table of at least size is requested. prime sizes are only chosen on growth, a
+        // caller asking for a specific size gets it
+        static size_t valid_size(size_t size) { return size; }
+
+        // smallest prime of at least size. for sizes worked out from a count rather than asked for, a composite size
+        // would leave quadratic probing and double hashing unable to reach most cells
+        static size_t fit_size(size_t size) {
+            size_t ret = std::max<size_t>(size, 2);
+            while (!is_prime(ret)) ret++;
+            return ret;
+        }
+
+        // size to grow to from size
+        static size_t next_size(size_t size) {
+            size_t ret = size * 2 + 1;
+            while (!is_prime(ret)) ret += 2;
+            return ret;
+        }
+
+        void resize(size_t size) { _size = size; }
+        size_t index(size_t hash) const { return hash % _size; }
+};
+
+class PowerOfTwoSizing {
+    private:
+        size_t _mask = 0;
+
+    public:
+        static constexpr bool power_of_two = true;
+
+        // fmix64, the 64 bit finalizer from MurmurHash3. spreads every input bit across the low bits the mask keeps, so
+        // identity hashes like std::hash<int> don't all land in the same few cells
+        static size_t mix(size_t hash) {
+            uint64_t h = hash;
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdULL;
+            h ^= h >> 33;
+            h *= 0xc4ceb9fe1a85ec53ULL;
+            h ^= h >> 33;
+            return static_cast<size_t>(h);
+        }
+
+        static size_t valid_size(size_t size) {
+            size_t ret = 1;
+            while (ret < size) ret <<= 1;
+            return ret;
+        }
+
+        static size_t fit_size(size_t size) { return valid_size(size); }
+        static size_t next_size(size_t size) { return valid_size(size) * 2; }
+
+        void resize(size_t size) { _mask = size - 1; }
+        size_t index(size_t hash) const { return mix(hash) & _mask; }
+};
+
+class PrimeFastModSizing {
+    private:
+        uint64_t _divisor = 1;
+        uint64_t _reciprocal = 0; // ceil(2^64 / divisor)
+
+    public:
+        static constexpr bool power_of_two = false;
+
+        // hash folded to the 32 bits fastmod works on
+        static uint32_t fold(size_t hash) {
+            uint64_t h = hash;
+            return static_cast<uint32_t>(h ^ (h >> 32));
+        }
+
+        static size_t valid_size(size_t size) { return size; }
+        static size_t fit_size(size_t size) { return PrimeModuloSizing::fit_size(size); }
+        static size_t next_size(size_t size) { return PrimeModuloSizing::next_size(size); }
+
+        void resize(size_t size) {
+            if (size > std::numeric_limits<uint32_t>::max()) throw std::length_error("table size too large for fastmod sizing");
+            _divisor = size;
+            _reciprocal = std::numeric_limits<uint64_t>::max() / _divisor + 1;
+        }
+
+        // Lemire, Kaser and Kurz, "Faster Remainder by Direct Computation" - exact fold(hash) % size
+        size_t index(size_t hash) const { return mulhi64(_reciprocal * fold(hash), _divisor); }
+};
+
+/*
+ *  Runtime statistics, opt-in through a table's Stats policy. A probe is a cell (open addressing) or chain node
+ *  (separate chaining) looked at while searching for a key. Every search counts: lookups, and the search an insert or
+ *  remove starts with, so inserting a new key is a miss.
+ *
+ *  NoStats      - counts nothing, the default. every hook is empty, a table without stats compiles to the same code
+ *  CollectStats - counts searches and their probes, split into hits and misses, and rehashes and the time spent in
+ *                 them. the counters are relaxed atomics, so lookups running together under a shared lock
+ *                 (ConcurrentHashTable) can count at once
+ *
+ *  A table with CollectStats has stats(), which returns the counters along with what is read off the table itself at
+ *  that moment (chain lengths, tombstones, bytes), and reset_stats().
+*/
+struct TableStats {
+    size_t hits = 0; // searches that found their key
+    size_t misses = 0;
+    size_t hit_probes = 0; // probes over all of them
+    size_t miss_probes = 0;
+    size_t max_hit_probes = 0;
+    size_t max_miss_probes = 0;
+    // chain_lengths[n] is how many buckets hold n keys (separate chaining), or how many keys are found n probes from
+    // their home cell (open addressing, the home cell being probe 1). a hash function that clusters keys shows up here
+    std::vector<size_t> chain_lengths{};
+    size_t tombstones = 0;
+    double tombstone_ratio = 0; // tombstones / table size
+    size_t rehashes = 0;        // counting purges of deleted cells
+    double rehash_seconds = 0;  // in rehashes, and in the migration steps of incremental ones
+    size_t bytes_allocated = 0; // by the table's own arrays, not counting memory the keys point to
+
+    double average_hit_probes() const { return hits ? static_cast<double>(hit_probes) / hits : 0; }
+    double average_miss_probes() const { return misses ? static_cast<double>(miss_probes) / misses : 0; }
+
+    // Prometheus text exposition format, every metric named prefix_<metric>. chain_lengths becomes a histogram
+    void print_prometheus(std::ostream& os, const std::string& prefix = "hashtable") const {
+        auto metric = [&](const char* name, const char* type, const char* help) {
+            os << "# HELP " << prefix << "_" << name << " " << help << "\n";
+            os << "# TYPE " << prefix << "_" << name << " " << type << "\n";
+        };
+        auto by_result = [&](const char* name, double hit, double miss) {
+            os << prefix << "_" << name << "{result=\"hit\"} " << hit << "\n";
+            os << prefix << "_" << name << "{result=\"miss\"} " << miss << "\n";
+        };
+
+        metric("searches_total", "counter", "Key searches.");
+        by_result("searches_total", static_cast<double>(hits), static_cast<double>(misses));
+        metric("probes_total", "counter", "Cells or chain nodes looked at by key searches.");
+        by_result("probes_total", static_cast<double>(hit_probes), static_cast<double>(miss_probes));
+        metric("average_probes", "gauge", "Probes per key search.");
+        by_result("average_probes", average_hit_probes(), average_miss_probes());
+        metric("max_probes", "gauge", "Longest key search, in probes.");
+        by_result("max_probes", static_cast<double>(max_hit_probes), static_cast<double>(max_miss_probes));
+
+        metric("chain_length", "histogram", "Keys per bucket, or probes to reach each key.");
+        size_t count = 0, sum = 0;
+        for (size_t length = 0; length < chain_lengths.size(); length++) {
+            count += chain_lengths[length];
+            sum += length * chain_lengths[length];
+            os << prefix << "_chain_length_bucket{le=\"" << length << "\"} " << count << "\n";
+        }
+        os << prefix << "_chain_length_bucket{le=\"+Inf\"} " << count << "\n";
+        os << prefix << "_chain_length_sum " << sum << "\n";
+        os << prefix << "_chain_length_count " << count << "\n";
+
+        metric("tombstones", "gauge", "Deleted cells.");
+        os << prefix << "_tombstones " << tombstones << "\n";
+        metric("tombstone_ratio", "gauge", "Deleted cells over table size.");
+        os << prefix << "_tombstone_ratio " << tombstone_ratio << "\n";
+        metric("rehashes_total", "counter", "Rehashes, counting purges of deleted cells.");
+        os << prefix << "_rehashes_total " << rehashes << "\n";
+        metric("rehash_seconds_total", "counter", "Time spent rehashing.");
+        os << prefix << "_rehash_seconds_total " << rehash_seconds << "\n";
+        metric("bytes_allocated", "gauge", "Bytes held by the table's arrays.");
+        os << prefix << "_bytes_allocated " << bytes_allocated << "\n";
+    }
+};
+
+struct NoStats {
+    static constexpr bool enabled = false;
+
+    struct RehashTimer {};
+
+    void count_search(bool, size_t) const {}
+    void count_rehash() const {}
+    RehashTimer time_rehash() const { return {}; }
+    void read_counters(TableStats&) const {}
+    void reset_counters() {}
+};
+
+class CollectStats {
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        mutable std::atomic<size_t> hits, misses, hit_probes, miss_probes, max_hit_probes, max_miss_probes;
+        mutable std::atomic<size_t> rehashes, rehash_nanoseconds;
+
+        static void raise(std::atomic<size_t>& max, size_t value) {
+            size_t current = max.load(std::memory_order_relaxed);
+            while (value > current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+        }
+
+    public:
+        static constexpr bool enabled = true;
+
+        // adds the time from its construction to its destruction to the rehash time
+        class RehashTimer {
+            private:
+                const CollectStats& stats;
+                Clock::time_point start;
+
+            public:
+                explicit RehashTimer(const CollectStats& stats) : stats{stats}, start{Clock::now()} {}
+                ~RehashTimer() {
+                    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+                    stats.rehash_nanoseconds.fetch_add(static_cast<size_t>(elapsed), std::memory_order_relaxed);
+                }
+                RehashTimer(const RehashTimer&) = delete;
+                RehashTimer& operator=(const RehashTimer&) = delete;
+        };
+
+        CollectStats()
+            : hits{0}, misses{0}, hit_probes{0}, miss_probes{0}, max_hit_probes{0}, max_miss_probes{0}, rehashes{0},
+              rehash_nanoseconds{0} {}
+        CollectStats(const CollectStats& other) : CollectStats() { *this = other; }
+        CollectStats& operator=(const CollectStats& other) {
+            hits.store(other.hits.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            misses.store(other.misses.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            hit_probes.store(other.hit_probes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            miss_probes.store(other.miss_probes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            max_hit_probes.store(other.max_hit_probes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            max_miss_probes.store(other.max_miss_probes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            rehashes.store(other.rehashes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            rehash_nanoseconds.store(other.rehash_nanoseconds.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            return *this;
+        }
+
+        void count_search(bool found, size_t probes) const {
+            (found ? hits : misses).fetch_add(1, std::memory_order_relaxed);
+            (found ? hit_probes : miss_probes).fetch_add(probes, std::memory_order_relaxed);
+            raise(found ? max_hit_probes : max_miss_probes, probes);
+        }
+        void count_rehash() const { rehashes.fetch_add(1, std::memory_order_relaxed); }
+        RehashTimer time_rehash() const { return RehashTimer(*this); }
+
+        void read_counters(TableStats& stats) const {
+            stats.hits = hits.load(std::memory_order_relaxed);
+            stats.misses = misses.load(std::memory_order_relaxed);
+            stats.hit_probes = hit_probes.load(std::memory_order_relaxed);
+            stats.miss_probes = miss_probes.load(std::memory_order_relaxed);
+            stats.max_hit_probes = max_hit_probes.load(std::memory_order_relaxed);
+            stats.max_miss_probes = max_miss_probes.load(std::memory_order_relaxed);
+            stats.rehashes = rehashes.load(std::memory_order_relaxed);
+            stats.rehash_seconds = rehash_nanoseconds.load(std::memory_order_relaxed) / 1e9;
+        }
+        void reset_counters() { *this = CollectStats(); }
+};
+
+/*
+ *  Streaming serialization, the write() and read() of each table. A stream is a header (StreamHeader) and then every
+ *  value as its 64-bit hash followed by its encoding, so reading it back never calls Hash or KeyEqual. Unlike the
+ *  snapshots of hashtable_open_addressing.h it works for any key with a StreamCodec and doesn't depend on the table's
+ *  memory layout, but it is written and read one value at a time.
+ *
+ *  StreamWriter and StreamReader buffer a std::ostream / std::istream, so each value costs a copy into or out of the
+ *  buffer rather than a stream call. StreamCodec<T> encodes one key or mapped value: trivially copyable types as their
+ *  bytes, strings as a 64-bit length then their characters, pairs as first then second. Specialize it for other types.
+*/
+class StreamWriter {
+    private:
+        std::ostream& out;
+        std::vector<char> buffer;
+        size_t used;
+
+    public:
+        explicit StreamWriter(std::ostream& out, size_t buffer_size = size_t{1} << 16) : out(out), buffer(buffer_size), used{0} {}
+        StreamWriter(const StreamWriter&) = delete;
+        StreamWriter& operator=(const StreamWriter&) = delete;
+
+        void write(const void* data, size_t bytes) {
+            if (used + bytes > buffer.size()) {
+                flush();
+                if (bytes >= buffer.size()) { // too big to be worth buffering
+                    out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+                    if (!out) throw std::runtime_error("stream write failed");
+                    return;
+                }
+            }
+            std::memcpy(buffer.data() + used, data, bytes);
+            used += bytes;
+        }
+        template <class T>
+        void put(const T& value) {
+            static_assert(std::is_trivially_copyable_v<T>, "put() writes raw bytes");
+            write(&value, sizeof(T));
+        }
+
+        // must be called once done, nothing is written out before that but whole buffers
+        void flush() {
+            out.write(buffer.data(), static_cast<std::streamsize>(used));
+            used = 0;
+            if (!out) throw std::runtime_error("stream write failed");
+        }
+};
+
+class StreamReader {
+    private:
+        std::istream& in;
+        std::vector<char> buffer;
+        size_t position; // next unread byte of buffer
+        size_t filled;
+
+    public:
+        explicit StreamReader(std::istream& in, size_t buffer_size = size_t{1} << 16)
+            : in(in), buffer(buffer_size), position{0}, filled{0} {}
+        StreamReader(const StreamReader&) = delete;
+        StreamReader& operator=(const StreamReader&) = delete;
+
+        void read(void* data, size_t bytes) {
+            char* destination = static_cast<char*>(data);
+            size_t available = filled - position;
+            if (bytes > available) {
+                std::memcpy(destination, buffer.data() + position, available);
+                destination += available;
+                bytes -= available;
+                position = filled = 0;
+                if (bytes >= buffer.size()) {
+                    in.read(destination, static_cast<std::streamsize>(bytes));
+                    if (static_cast<size_t>(in.gcount()) != bytes) throw std::runtime_error("stream ended early");
+                    return;
+                }
+                in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                filled = static_cast<size_t>(in.gcount());
+                if (filled < bytes) throw std::runtime_error("stream ended early");
+            }
+            std::memcpy(destination, buffer.data() + position, bytes);
+            position += bytes;
+        }
+        template <class T>
+        T get() {
+            static_assert(std::is_trivially_copyable_v<T>, "get() reads raw bytes");
+            T value;
+            read(&value, sizeof(T));
+            return value;
+        }
+
+        // the reader reads ahead. once done, this hands what it didn't use back to a stream that can seek (files and
+        // string streams), so whatever follows in it can still be read
+        void finish() {
+            if (position == filled) return;
+            in.clear();
+            in.seekg(-static_cast<std::streamoff>(filled - position), std::ios::cur);
+            position = filled = 0;
+        }
+};
+
+template <class T>
+struct StreamCodec {
+    static_assert(std::is_trivially_copyable_v<T>, "no StreamCodec for this type, specialize one");
+    static void write(StreamWriter& out, const T& value) { out.put(value); }
+    static void read(StreamReader& in, T& value) { in.read(&value, sizeof(T)); }
+};
+
+template <class Char, class Traits, class Allocator>
+struct StreamCodec<std::basic_string<Char, Traits, Allocator>> {
+    using String = std::basic_string<Char, Traits, Allocator>;
+    static void write(StreamWriter& out, const String& value) {
+        out.put(static_cast<uint64_t>(value.size()));
+        out.write(value.data(), value.size() * sizeof(Char));
+    }
+    // straight into value's own storage, no temporary string
+    static void read(StreamReader& in, String& value) {
+        uint64_t length = in.get<uint64_t>();
+        if (length > value.max_size()) throw std::runtime_error("stream holds a damaged string length");
+        value.resize(static_cast<size_t>(length));
+        in.read(value.data(), value.size() * sizeof(Char));
+    }
+};
+
+template <class First, class Second>
+struct StreamCodec<std::pair<First, Second>> {
+    static void write(StreamWriter& out, const std::pair<First, Second>& value) {
+        StreamCodec<First>::write(out, value.first);
+        StreamCodec<Second>::write(out, value.second);
+    }
+    static void read(StreamReader& in, std::pair<First, Second>& value) {
+        StreamCodec<First>::read(in, value.first);
+        StreamCodec<Second>::read(in, value.second);
+    }
+};
+
+constexpr char stream_magic[8] = {'H', 'T', 'S', 'T', 'R', 'E', 'A', 'M'};
+constexpr uint32_t stream_version = 1;
+
+struct StreamHeader {
+    uint64_t count;        // values that follow
+    uint64_t table_size;   // cells or buckets of the table written
+    float max_load_factor;
+    uint64_t hash_check;   // Hash of a default constructed key, a reader with another Hash doesn't match it
+};
+
+inline void write_stream_header(StreamWriter& out, const StreamHeader& header) {
+    out.write(stream_magic, sizeof(stream_magic));
+    out.put(stream_version);
+    out.put(header.count);
+    out.put(header.table_size);
+    out.put(header.max_load_factor);
+    out.put(header.hash_check);
+}
+
+// throws unless the stream starts with a header a table hashing its keys to hash_check could read
+inline StreamHeader read_stream_header(StreamReader& in, uint64_t hash_check) {
+    char magic[sizeof(stream_magic)];
+    in.read(magic, sizeof(magic));
+    if (std::memcmp(magic, stream_magic, sizeof(magic)) != 0) throw std::runtime_error("not a hashtable stream");
+    if (in.get<uint32_t>() != stream_version) throw std::runtime_error("hashtable stream of an unsupported version");
+    StreamHeader header;
+    header.count = in.get<uint64_t>();
+    header.table_size = in.get<uint64_t>();
+    header.max_load_factor = in.get<float>();
+    header.hash_check = in.get<uint64_t>();
+    if (header.hash_check != hash_check) throw std::runtime_error("hashtable stream was written with another Hash");
+    if (!(header.max_load_factor > 0)) throw std::runtime_error("hashtable stream has a damaged header");
+    return header;
+}
@@ -0,0 +1,274 @@
+/*
+ *  Open addressing hashtable for read-mostly use from many threads, where contains() takes no lock and writes nothing
+ *  another thread reads. Writers (insert, remove, make_empty) are serialized by a mutex.
+ *
+ *  Lookups are read-copy-update style. A key is written into an empty cell before its status is published with a
+ *  release store, and a published key is never written again: removal only marks the cell deleted, and deleted cells
+ *  are not reused in place. They are cleared by building a new cell array (also how the table grows), publishing it,
+ *  and retiring the old one. A retired array is freed once no reader can still be looking at it, which is tracked by
+ *  epochs: a reader announces the epoch it started in, in a slot only it writes, and each retire advances the epoch.
+ *  Quadratic probing over prime sizes, max load factor .5 counting deleted cells.
+*/
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "hashtable_policies.h"
+
+// epochs shared by every RcuHashTable in the process. each reading thread claims one slot the first time it reads and
+// gives it back when it exits
+class EpochDomain {
+
+    public:
+        static constexpr size_t max_threads = 1024;
+
+        static EpochDomain& global() {
+            static EpochDomain domain;
+            return domain;
+        }
+
+        // epoch 0 marks an idle slot, so the first epoch is 1
+        uint64_t current() const { return epoch.load(); }
+        uint64_t advance() { return epoch.fetch_add(1); } // returns the epoch that just ended
+
+        // marks the calling thread as reading from the current epoch until the returned guard is destroyed
+        class ReadGuard {
+            private:
+                std::atomic<uint64_t>& announced;
+
+            public:
+                explicit ReadGuard(EpochDomain& domain) : announced{domain.thread_slot().epoch} {
+                    announced.store(domain.current()); // seq_cst, so it is ordered before the reader loads any array
+                }
+                ~ReadGuard() { announced.store(0, std::memory_order_release); }
+                ReadGuard(const ReadGuard&) = delete;
+                ReadGuard& operator=(const ReadGuard&) = delete;
+        };
+
+        // true when no reader started in epoch or earlier is still reading
+        bool quiescent(uint64_t epoch) const {
+            for (const Slot& slot : slots) {
+                uint64_t announced = slot.epoch.load();
+                if (announced != 0 && announced <= epoch) return false;
+            }
+            return true;
+        }
+
+    private:
+        // each slot on its own cache line, so a reader announcing itself never touches a line another reader writes
+        struct alignas(64) Slot {
+            std::atomic<uint64_t> epoch;
+            std::atomic<bool> in_use;
+            Slot() : epoch{0}, in_use{false} {}
+        };
+
+        // returns the slot when the thread exits
+        struct SlotHandle {
+            Slot* slot;
+            SlotHandle() : slot{nullptr} {}
+            ~SlotHandle() { if (slot) slot->in_use.store(false, std::memory_order_release); }
+            SlotHandle(const SlotHandle&) = delete;
+            SlotHandle& operator=(const SlotHandle&) = delete;
+        };
+
+        std::atomic<uint64_t> epoch;
+        Slot slots[max_threads];
+
+        EpochDomain() : epoch{1}, slots{} {}
+
+        Slot& thread_slot() {
+            static thread_local SlotHandle handle;
+            if (!handle.slot) {
+                for (Slot& slot : slots) {
+                    bool expected = false;
+                    if (!slot.in_use.load(std::memory_order_relaxed) && slot.in_use.compare_exchange_strong(expected, true)) {
+                        handle.slot = &slot;
+                        break;
+                    }
+                }
+                if (!handle.slot) throw std::runtime_error("too many threads reading from RcuHashTable");
+            }
+            return *handle.slot;
+        }
+};
+
+template <class Key, class Hash=std::hash<Key>, class KeyEqual=std::equal_to<Key>>
+class RcuHashTable {
+
+    private:
+        enum CellStatus : int8_t { EMPTY_CELL = 0, ACTIVE_CELL = 1, DELETED_CELL = 2 };
+
+        struct Cell {
+            std::atomic<int8_t> status;
+            Key key;
+            Cell() : status{EMPTY_CELL}, key{} {}
+        };
+
+        // a cell array is never resized, a table that needs a different one builds a new one
+        struct Cells {
+            std::vector<Cell> cells;
+            PrimeModuloSizing sizing;
+            explicit Cells(size_t size) : cells(size), sizing{} { sizing.resize(size); }
+            size_t size() const { return cells.size(); }
+        };
+
+        std::atomic<Cells*> current;
+        std::vector<std::pair<uint64_t, std::unique_ptr<Cells>>> retired; // with the epoch each was retired in
+        mutable std::mutex writer;
+        std::atomic<size_t> _size;
+        size_t deleted_cell_count; // writer only
+        float _max_load_factor;
+
+        static EpochDomain& domain() { return EpochDomain::global(); }
+
+        // quadratic probing, as in hashtable_open_addressing.h. returns the cell holding key, or the empty cell that
+        // ended the search with found false, table.size() if the (size + 1) / 2 cells the sequence reaches are all
+        // taken. safe to call from readers and the writer
+        static std::pair<size_t, bool> find_slot(const Cells& table, const Key& key) {
+            size_t index = table.sizing.index(Hash{}(key));
+            for (size_t i = 1; i <= table.size() / 2 + 1; i++) {
+                int8_t status = table.cells[index].status.load(std::memory_order_acquire);
+                if (status == EMPTY_CELL) return {index, false};
+                if (status == ACTIVE_CELL && KeyEqual{}(table.cells[index].key, key)) return {index, true};
+
+                size_t step = 2 * i - 1;
+                if (step >= table.size()) step %= table.size();
+                index += step;
+                if (index >= table.size()) index -= table.size();
+            }
+            return {table.size(), false};
+        }
+
+        // writer only. key is written before the status that publishes it
+        static void publish(Cells& table, size_t index, const Key& key) {
+            table.cells[index].key = key;
+            table.cells[index].status.store(ACTIVE_CELL, std::memory_order_release);
+        }
+
+        // writer only. copies the active keys into a new array of size cells, publishes it and retires the old one.
+        // keys are copied, not moved: readers may still be comparing against the old array
+        void rebuild(size_t size) {
+            Cells* old_table = current.load(std::memory_order_relaxed);
+            auto table = std::make_unique<Cells>(size);
+            for (const Cell& cell : old_table->cells) {
+                if (cell.status.load(std::memory_order_relaxed) == ACTIVE_CELL)
+                    publish(*table, find_slot(*table, cell.key).first, cell.key);
+            }
+            current.store(table.release()); // seq_cst, ordered against the readers' epoch announcements
+            deleted_cell_count = 0;
+            retired.emplace_back(domain().advance(), std::unique_ptr<Cells>(old_table));
+            reclaim_retired();
+        }
+
+        // writer only. frees every retired array no reader can still be using
+        void reclaim_retired() {
+            for (size_t i = 0; i < retired.size(); ) {
+                if (domain().quiescent(retired[i].first)) {
+                    retired[i] = std::move(retired.back());
+                    retired.pop_back();
+                } else {
+                    i++;
+                }
+            }
+        }
+
+    public:
+        // constructors
+        RcuHashTable() : RcuHashTable(11) {}
+        explicit RcuHashTable(size_t size)
+            : current{new Cells(size)}, retired{}, writer{}, _size{0}, deleted_cell_count{0}, _max_load_factor{0.5} {}
+
+        // the table must no longer be in use by any thread
+        ~RcuHashTable() { delete current.load(); }
+
+        RcuHashTable(const RcuHashTable&) = delete;
+        RcuHashTable& operator=(const RcuHashTable&) = delete;
+
+        // capacity
+        bool is_empty() const { return size() == 0; }
+        size_t size() const { return _size.load(std::memory_order_relaxed); }
+        size_t table_size() const {
+            EpochDomain::ReadGuard guard(domain());
+            return current.load()->size();
+        }
+
+        // modifiers
+        bool insert(const Key& value) { // returns true on successful insert, false on failed insert
+            std::lock_guard<std::mutex> lock(writer);
+            if (!retired.empty()) reclaim_retired();
+
+            Cells* table = current.load(std::memory_order_relaxed);
+            auto [index, found] = find_slot(*table, value);
+            if (found) return false;
+
+            // rehash check. deleted cells are never reused so they count towards the load. grow when the active keys
+            // need the room, otherwise a rebuild at the same size clears the deleted cells. the same goes for a probe that
+            // reached its limit without an empty cell
+            size_t occupied = _size.load(std::memory_order_relaxed) + deleted_cell_count + 1;
+            if (index == table->size() || static_cast<float>(occupied) / table->size() > _max_load_factor) {
+                if (static_cast<float>(_size.load(std::memory_order_relaxed) + 1) / table->size() > _max_load_factor)
+                    rebuild(PrimeModuloSizing::next_size(table->size()));
+                else
+                    rebuild(table->size());
+                table = current.load(std::memory_order_relaxed);
+                index = find_slot(*table, value).first;
+                while (index == table->size()) {
+                    rebuild(PrimeModuloSizing::next_size(table->size()));
+                    table = current.load(std::memory_order_relaxed);
+                    index = find_slot(*table, value).first;
+                }
+            }
+
+            publish(*table, index, value);
+            _size.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        size_t remove(const Key& value) { // returns 1 on successful removal, 0 on failed removal
+            std::lock_guard<std::mutex> lock(writer);
+            if (!retired.empty()) reclaim_retired();
+
+            Cells* table = current.load(std::memory_order_relaxed);
+            auto [index, found] = find_slot(*table, value);
+            if (!found) return 0;
+            // the key stays in the cell, readers that already matched it are not disturbed
+            table->cells[index].status.store(DELETED_CELL, std::memory_order_release);
+            deleted_cell_count++;
+            _size.fetch_sub(1, std::memory_order_relaxed);
+            return 1;
+        }
+
+        void make_empty() {
+            std::lock_guard<std::mutex> lock(writer);
+            Cells* old_table = current.load(std::memory_order_relaxed);
+            current.store(new Cells(old_table->size()));
+            _size.store(0, std::memory_order_relaxed);
+            deleted_cell_count = 0;
+            retired.emplace_back(domain().advance(), std::unique_ptr<Cells>(old_table));
+            reclaim_retired();
+        }
+
+        // frees retired cell arrays whose readers have all finished. writers also do this as they go
+        void reclaim() {
+            std::lock_guard<std::mutex> lock(writer);
+            reclaim_retired();
+        }
+
+        // lookup. lock free: one store to announce the epoch, one to leave it, both to this thread's own slot
+        bool contains(const Key& value) const {
+            EpochDomain::ReadGuard guard(domain());
+            return find_slot(*current.load(), value).second;
+        }
+
+        // FOR TESTING ONLY
+        size_t retired_count() const {
+            std::lock_guard<std::mutex> lock(writer);
+            return retired.size();
+        }
+};
@@ -0,0 +1,166 @@
+#include "hashtable_rcu.h"
+#include <thread>
+#include <atomic>
+#include <iostream>
+
+#define black   "\033[30m"
+#define red     "\033[31m"
+#define green   "\033[32m"
+#define yellow  "\033[33m"
+#define blue    "\033[34m"
+#define magenta "\033[35m"
+#define cyan    "\033[36m"
+#define white   "\033[37m"
+#define reset   "\033[m"
+
+#define to_be ==
+#define not_to_be !=
+#define is to_be
+#define is_not not_to_be
+
+#define expect(X) try {\
+  if (!(X)) {\
+    std::cout << red "  [fail]" reset " (" << __FILE__ << ":" << __FUNCTION__ << ":" << __LINE__ << ") " << red << "expected " << #X << "." << reset << std::endl;\
+  }\
+} catch(...) {\
+  std::cout << red "  [fail]" reset " (" << __FILE__ << ":" << __FUNCTION__ << ":" << __LINE__ << ") " << red << #X << " threw an unexpected exception." << reset << std::endl;\
+}
+
+#define assert(X) try {\
+  if (!(X)) {\
+    std::cout << red "  [fail]" reset " (" << __FILE__ << ":" << __FUNCTION__ << ":" << __LINE__ << ") " << red << "failed assertion that " << #X << "." << reset << std::endl;\
+    std::abort();\
+  }\
+} catch(...) {\
+  std::cout << red "  [fail]" reset " (" << __FILE__ << ":" << __FUNCTION__ << ":" << __LINE__ << ") " << red << #X << " assertion threw an unexpected exception." << reset << std::endl;\
+}
+
+#define expect_throw(X,E) {\
+  bool threw_expected_exception = false;\
+  try { X; }\
+  catch(const E& err) {\
+    threw_expected_exception = true;\
+  } catch(...) {\
+    std::cout << blue << "  [help] " << #X << " threw an incorrect exception." << reset << std::endl;\
+  }\
+  if (!threw_expected_exception) {\
+    std::cout << red <<"  [fail]" << reset << " (" << __FILE__ << ":" << __FUNCTION__ << ":" << __LINE__ << ") " << red << "expected " << #X << " to throw " << #E <<"." << reset <<std::endl;\
+  }\
+}
+
+#define expect_no_throw(X) {\
+  try { X; }\
+  catch(...) {\
+    std::cout << red << "  [fail]" << red << " (" << __FILE__ << ":" << __FUNCTION__ << ":" << __LINE__ << ") " << red << "expected " << #X << " not to throw an excpetion." << reset << std::endl;\
+  }\
+}
+
+// runs body(t) on threads 0 to count - 1 and waits for all of them
+template <class Body>
+void run_threads(size_t count, Body body) {
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < count; t++) threads.emplace_back(body, t);
+    for (std::thread& thread : threads) thread.join();
+}
+
+
+int main() {
+    // is_empty() / make_empty
+    {
+        RcuHashTable<int> intTable;
+        expect(intTable.is_empty() to_be true);
+        expect(intTable.table_size() to_be 11);
+        intTable.insert(1);
+        expect(intTable.is_empty() to_be false);
+        intTable.make_empty();
+        expect(intTable.is_empty() to_be true);
+        expect(intTable.contains(1) to_be false);
+        expect(intTable.table_size() to_be 11);
+        expect(intTable.retired_count() to_be 0); // no reader was active, freed straight away
+    }
+
+    // insert / remove / contains
+    {
+        RcuHashTable<int> intTable;
+        expect(intTable.insert(1) to_be true);
+        expect(intTable.insert(1) to_be false);
+        expect(intTable.insert(12) to_be true); // collides with 1
+        expect(intTable.contains(1) to_be true);
+        expect(intTable.contains(12) to_be true);
+        expect(intTable.contains(23) to_be false);
+        expect(intTable.size() to_be 2);
+        expect(intTable.remove(1) to_be 1);
+        expect(intTable.remove(1) to_be 0);
+        expect(intTable.contains(1) to_be false);
+        expect(intTable.contains(12) to_be true); // still found past the deleted cell
+        expect(intTable.insert(1) to_be true);
+        expect(intTable.contains(1) to_be true);
+        expect(intTable.size() to_be 2);
+
+        RcuHashTable<std::string> stringTable(23);
+        expect(stringTable.table_size() to_be 23);
+        expect(stringTable.insert("hello") to_be true);
+        expect(stringTable.contains("hello") to_be true);
+        expect(stringTable.contains("world") to_be false);
+    }
+
+    // insert which cause a rehash
+    {
+        RcuHashTable<int> intTable;
+        for (int i = 0; i < 5; i++) intTable.insert(i);
+        expect(intTable.table_size() to_be 11);
+        intTable.insert(5);
+        expect(intTable.table_size() to_be 23);
+        for (int i = 0; i < 6; i++) expect(intTable.contains(i) to_be true);
+        expect(intTable.retired_count() to_be 0);
+
+        RcuHashTable<int> largeTable;
+        for (int i = 0; i < 100000; i++) largeTable.insert(i * 3);
+        expect(largeTable.size() to_be 100000);
+        for (int i = 0; i < 100000; i++) assert(largeTable.contains(i * 3) to_be true);
+        for (int i = 0; i < 100000; i++) assert(largeTable.contains(i * 3 + 1) to_be false);
+    }
+
+    // deleted cells are cleared by a rebuild at the same size
+    {
+        RcuHashTable<int> intTable;
+        for (int i = 0; i < 1000; i++) {
+            expect(intTable.insert(i) to_be true);
+            if (i >= 4) expect(intTable.remove(i - 4) to_be 1);
+        }
+        expect(intTable.table_size() to_be 11);
+        expect(intTable.size() to_be 4);
+        for (int i = 0; i < 1000; i++) assert(intTable.contains(i) to_be (i >= 996));
+    }
+
+    // readers alongside a writer
+    {
+        RcuHashTable<int> intTable;
+        for (int i = 0; i < 1000; i++) intTable.insert(i * 2); // evens stay put for the whole test
+        std::atomic<int> published{0}; // odd keys below 2 * published are in the table
+        std::atomic<bool> missing{false};
+        run_threads(8, [&](size_t t) {
+            if (t == 0) {
+                for (int i = 0; i < 20000; i++) {
+                    intTable.insert(i * 2 + 1);
+                    published.store(i + 1, std::memory_order_release);
+                }
+                for (int i = 0; i < 1000; i++) intTable.remove(i * 2 + 1); // and some churn at the end
+            } else {
+                for (int round = 0; round < 50; round++) {
+                    int seen = published.load(std::memory_order_acquire);
+                    for (int i = 0; i < 1000; i++)
+                        if (!intTable.contains(i * 2)) missing = true;
+                    for (int i = 1000; i < seen; i += 97)
+                        if (!intTable.contains(i * 2 + 1)) missing = true;
+                }
+            }
+        });
+        expect(missing.load() to_be false);
+        expect(intTable.size() to_be 20000);
+        intTable.reclaim();
+        expect(intTable.retired_count() to_be 0); // every reader is done
+    }
+
+    return 0;
+}
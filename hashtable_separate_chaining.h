@@ -1,107 +1,663 @@
 /*
- *  Implementation of a separate chaining hashtable which has an underlying vector of lists of keys. Max load factor is set to 1.0 by default
+ *  Implementation of a separate chaining hashtable. Max load factor is set to 1.0 by default
+ *  Each bucket is a singly linked chain of nodes, but the nodes live in one pool owned by the table and link to each
+ *  other by 32 bit index, so an insert or remove doesn't go to the allocator once the pool is big enough: removed nodes
+ *  go on a free list and are reused first. The pool and bucket array come from Allocator (pmr::HashTable and
+ *  pmr::HashMap use a std::pmr::memory_resource). Growing the pool can move
+ *  the nodes, so pointers to values (HashMap::find and friends) are only good until the next insert.
+ *  Bucket counts and index reduction come from the Sizing policy (see hashtable_policies.h)
+ *  Growth can be made incremental (incremental_rehash), spreading the relinking of the old buckets over later inserts
+ *  and removes instead of doing it all in the insert that triggered it. Rehashing and bulk construction can be spread
+ *  over several threads instead (rehash_threads, HashTable(first, last, threads)).
+ *  With the CacheHashes policy each node also keeps its key's full hash, so rehashes never call Hash and lookups compare
+ *  hashes before keys. RecomputeHashes (the default) saves the 8 bytes a node.
+ *  With the CollectStats policy the table counts its probes and rehashes, see stats() and hashtable_policies.h.
+ *  Iterators walk the buckets in order, for_each and extract_all walk the node pool in memory order instead.
+ *  write() and read() stream a table in a binary format that loads without hashing or comparing keys, see
+ *  hashtable_policies.h.
+ *  SeparateChainingTable is the engine, HashTable (a set of keys) and HashMap (keys with mapped values) are built on it.
  *  Written by Zach Schrag
 */
 
 
 #pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <functional>
 #include <vector>
-#include <list>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
 #include <stdexcept>
+#include <utility>
+#include <tuple>
+#include <type_traits>
 #include <iostream> // for print_table only
+#include "hashtable_policies.h"
 
-using std::vector, std::list, std::cout, std::endl;
+using std::vector, std::cout, std::endl;
 
-template <class Key, class Hash=std::hash<Key>>
-class HashTable {
+// hash caching policies, whether a node stores its key's hash
+struct RecomputeHashes {
+    static constexpr bool cache_hash = false;
+};
 
-    private:
-        vector<list<Key>> table;
+struct CacheHashes {
+    static constexpr bool cache_hash = true;
+};
+
+template <class Key, class Slot, class Hash, class KeyEqual, class Sizing, class Allocator, class HashCaching, class Stats>
+class SeparateChainingTable : protected Stats {
+
+    public:
+        template <bool Const>
+        class Iterator; // see below, emplace_hashed() returns one
+
+    protected:
+        using Value = typename Slot::value_type;
+        using Index = uint32_t;
+        static constexpr Index npos = std::numeric_limits<Index>::max(); // end of a chain
+
+        // the hash a node stores, nothing unless HashCaching asks for it
+        template <bool Cached, class = void>
+        struct NodeHash {
+            NodeHash() {}
+        };
+        template <class Unused>
+        struct NodeHash<true, Unused> {
+            size_t hash;
+            NodeHash() : hash{0} {}
+        };
+
+        // a key (or key/mapped value pair) and the pool index of the next node in its chain or the free list
+        struct Node : NodeHash<HashCaching::cache_hash> {
+            Value value;
+            Index next;
+            template <class... Args>
+            explicit Node(Index next, Args&&... args) : NodeHash<HashCaching::cache_hash>(), value(std::forward<Args>(args)...), next{next} {}
+        };
+
+        using NodeAllocator = rebind_alloc_t<Allocator, Node>;
+        using IndexAllocator = rebind_alloc_t<Allocator, Index>;
+
+        vector<Index, IndexAllocator> table; // first node of each bucket
+        vector<Node, NodeAllocator> nodes;   // every node the table owns, chained together by index
+        Index free_list;                     // removed nodes, reused before the pool grows
         size_t _size;
         float _current_load_factor;
         float _max_load_factor;
 
-        // Primality test in C-family on Wikipedia: https://en.wikipedia.org/wiki/Primality_test#C,_C++,_C#_&_D - this is not my algorithm
-        bool is_prime(size_t n) {
-            if (n == 2 || n == 3) return true;
-            if (n <= 1 || n % 2 == 0 || n % 3 == 0) return false;
-            for (size_t i = 5; i * i <= n; i += 6)
-                if (n % i == 0 || n % (i + 2) == 0) return false;
+        // maps hashes to buckets, kept in sync with table.size() through resize()
+        Sizing sizing;
+
+        // incremental rehash. while old_table is not empty the table is moving from it to table, old_table's buckets
+        // before migrated have been relinked. each insert or remove handles the next migration_step buckets, never fewer than
+        // _rehash_step (0 means rehashes are done all at once)
+        vector<Index, IndexAllocator> old_table;
+        Sizing old_sizing;
+        size_t migrated;
+        size_t migration_step;
+        size_t _rehash_step;
+
+        // threads rehash() may use, see rehash_threads()
+        unsigned _rehash_threads;
 
-            return true;
+        // enables the lookup overloads taking any key type Hash and KeyEqual accept, see is_transparent_lookup. K keeps
+        // the condition dependent so it can be used with enable_if
+        template <class K>
+        static constexpr bool transparent = is_transparent_lookup<Hash, KeyEqual>::value && !std::is_same_v<K, Key>;
+
+        // hash of node's key, stored in the node when HashCaching caches it
+        size_t node_hash(Index node) const {
+            if constexpr (HashCaching::cache_hash) return nodes[node].hash;
+            else return Hash{}(Slot::key(nodes[node].value));
+        }
+        void set_node_hash(Index node, size_t hash_value) {
+            if constexpr (HashCaching::cache_hash) nodes[node].hash = hash_value;
         }
 
-        // helper method for rehashing
-        size_t find_next_prime(size_t size) {
-            size_t ret = size * 2 + 1;
-            while (!is_prime(ret)) ret += 2;
-            return ret;
+        // whether node holds key. with cached hashes a differing hash rules it out before KeyEqual is called
+        template <class K>
+        bool matches(Index node, const K& key, size_t hash_value) const {
+            if constexpr (HashCaching::cache_hash) {
+                if (nodes[node].hash != hash_value) return false;
+            }
+            return KeyEqual{}(Slot::key(nodes[node].value), key);
         }
 
-    public:
-        // constructors
-        HashTable() : table{11}, _size{0}, _current_load_factor{0.0}, _max_load_factor{1.0} {}
-        explicit HashTable(size_t size) : table{size}, _size{0}, _current_load_factor{0.0}, _max_load_factor{1.0} {}
+        // node holding key in the chain starting at node, npos if there is none. adds the nodes looked at to probes
+        template <class K>
+        Index find_node(const K& key, size_t hash_value, Index node, size_t& probes) const {
+            for (; node != npos; node = nodes[node].next) {
+                probes++;
+                if (matches(node, key, hash_value)) return node;
+            }
 
-        // capacity
-        bool is_empty() const { return _size == 0; }
-        size_t size() const { return _size; }
+            return npos;
+        }
 
-        // modifiers
-        void make_empty() { 
-            table = vector<list<Key>>{table.size()};
-            _size = 0;
-            _current_load_factor = 0.0;
+        // value with key in the chain starting at node, nullptr if there is none. adds the nodes looked at to probes
+        template <class K>
+        const Value* find_in_chain(const K& key, size_t hash_value, Index node, size_t& probes) const {
+            node = find_node(key, hash_value, node, probes);
+            return node != npos ? &nodes[node].value : nullptr;
+        }
+
+        // value with key in either table, nullptr if there is none
+        template <class K>
+        const Value* find_value(const K& key, size_t hash_value) const {
+            size_t probes = 0;
+            const Value* value = find_in_chain(key, hash_value, table[sizing.index(hash_value)], probes);
+            if (!value && is_rehashing()) {
+                size_t index = old_sizing.index(hash_value);
+                if (index >= migrated) value = find_in_chain(key, hash_value, old_table[index], probes);
+            }
+            this->count_search(value != nullptr, probes);
+            return value;
+        }
+        template <class K>
+        Value* find_value(const K& key, size_t hash_value) {
+            return const_cast<Value*>(static_cast<const SeparateChainingTable*>(this)->find_value(key, hash_value));
+        }
+
+        // unlinks the node holding key from the chain link points into and frees it. returns 1 on successful removal, 0
+        // on failed removal. adds the nodes looked at to probes
+        template <class K>
+        size_t unlink(const K& key, size_t hash_value, Index* link, size_t& probes) {
+            for (; *link != npos; link = &nodes[*link].next) {
+                probes++;
+                if (matches(*link, key, hash_value)) {
+                    release(link);
+                    return 1;
+                }
+            }
+
+            return 0;
+        }
+
+        // unlinks the node link points to and puts it on the free list. the value is reset so the free node doesn't
+        // keep what it held alive
+        void release(Index* link) {
+            Index node = *link;
+            *link = nodes[node].next;
+            nodes[node].value = Value{};
+            nodes[node].next = free_list;
+            free_list = node;
+            _size--;
+            _current_load_factor = static_cast<float>(_size) / table.size();
+        }
+
+        // iteration runs over the buckets of table, then those of old_table as if they followed on. buckets not yet
+        // relinked are the only ones of old_table with nodes in them
+        size_t bucket_total() const { return table.size() + old_table.size(); }
+        Index& head(size_t bucket) { return bucket < table.size() ? table[bucket] : old_table[bucket - table.size()]; }
+        Index head(size_t bucket) const { return bucket < table.size() ? table[bucket] : old_table[bucket - table.size()]; }
+
+        // which pool nodes are on the free list, so a walk of the pool can skip them
+        vector<bool> free_nodes() const {
+            vector<bool> free(nodes.size(), false);
+            for (Index node = free_list; node != npos; node = nodes[node].next) free[node] = true;
+            return free;
+        }
+
+        // {bucket, node} holding key as iteration sees them, {bucket_total(), npos} if there is none
+        template <class K>
+        std::pair<size_t, Index> locate(const K& key, size_t hash_value) const {
+            size_t probes = 0, bucket = sizing.index(hash_value);
+            Index node = find_node(key, hash_value, table[bucket], probes);
+            if (node == npos && is_rehashing()) {
+                size_t index = old_sizing.index(hash_value);
+                if (index >= migrated) {
+                    bucket = table.size() + index;
+                    node = find_node(key, hash_value, old_table[index], probes);
+                }
+            }
+            this->count_search(node != npos, probes);
+            return node != npos ? std::pair<size_t, Index>{bucket, node} : std::pair<size_t, Index>{bucket_total(), npos};
+        }
+
+        // relinks every node of the chain starting at bucket into table, nodes stay where they are in the pool
+        void relink(Index bucket) {
+            while (bucket != npos) {
+                Index node = bucket;
+                bucket = nodes[node].next;
+                Index& destination = table[sizing.index(node_hash(node))];
+                nodes[node].next = destination;
+                destination = node;
+            }
+        }
+
+        // relinks the next count buckets of old_table, and drops old_table once all of it has been
+        void migrate(size_t count) {
+            if (!is_rehashing()) return;
+            [[maybe_unused]] auto timer = this->time_rehash();
+            for (; count != 0 && migrated < old_table.size(); migrated++, count--) {
+                relink(old_table[migrated]);
+                old_table[migrated] = npos;
+            }
+            if (is_rehashing() && migrated == old_table.size()) {
+                old_table.clear();
+                old_table.shrink_to_fit();
+            }
+        }
+
+        // bucket heads shared by the threads of a parallel rehash or bulk insert. a node is linked by pointing it at the
+        // current head and swapping itself in, retrying if another thread got there first
+        using SharedBuckets = vector<std::atomic<Index>>;
+
+        SharedBuckets shared_buckets(size_t count, unsigned threads) const {
+            SharedBuckets buckets(count);
+            parallel_for(count, threads, [&](size_t begin, size_t end) {
+                for (size_t index = begin; index < end; index++) buckets[index].store(npos, std::memory_order_relaxed);
+            });
+            return buckets;
+        }
+
+        // copies the heads of buckets into table once every thread is done with them
+        void publish_buckets(const SharedBuckets& buckets, unsigned threads) {
+            parallel_for(buckets.size(), threads, [&](size_t begin, size_t end) {
+                for (size_t index = begin; index < end; index++) table[index] = buckets[index].load(std::memory_order_relaxed);
+            });
+        }
+
+        // relink() for several threads at once, each relinking the chains of its own range of old buckets
+        void parallel_relink(const vector<Index, IndexAllocator>& old_buckets) {
+            SharedBuckets buckets = shared_buckets(table.size(), _rehash_threads);
+            parallel_for(old_buckets.size(), _rehash_threads, [&](size_t begin, size_t end) {
+                for (size_t bucket = begin; bucket < end; bucket++) {
+                    for (Index node = old_buckets[bucket], next; node != npos; node = next) {
+                        next = nodes[node].next;
+                        std::atomic<Index>& head = buckets[sizing.index(node_hash(node))];
+                        Index first = head.load(std::memory_order_relaxed);
+                        do nodes[node].next = first;
+                        while (!head.compare_exchange_weak(first, node, std::memory_order_relaxed));
+                    }
+                }
+            });
+            publish_buckets(buckets, _rehash_threads);
+        }
+
+        // moves the nodes in use into a pool of exactly their number, bucket by bucket, so the free list goes away. no
+        // rehash may be in progress
+        void compact_nodes() {
+            vector<Node, NodeAllocator> compacted(nodes.get_allocator());
+            compacted.reserve(_size); // so link stays valid while nodes are appended
+            for (Index& bucket : table) {
+                Index* link = &bucket;
+                for (Index node = bucket; node != npos; node = nodes[node].next) {
+                    *link = static_cast<Index>(compacted.size());
+                    compacted.push_back(std::move(nodes[node]));
+                    link = &compacted.back().next;
+                }
+                *link = npos;
+            }
+            nodes.swap(compacted);
+            free_list = npos;
+        }
+
+        // bucket count that holds count keys under the default max load factor
+        static size_t size_for(size_t count) { return Sizing::fit_size(count + 1); }
+
+        // replaces the contents of a newly constructed table with the values write() wrote to is. the pool is sized for
+        // all of them up front, each value is decoded straight into its node and linked into the bucket its stored hash
+        // picks: no key is hashed, compared or moved
+        void read_stream(std::istream& is) {
+            StreamReader in(is);
+            StreamHeader header = read_stream_header(in, Hash{}(Key{}));
+            if (header.count >= npos) throw std::length_error("separate chaining table node pool is full");
+            _max_load_factor = header.max_load_factor;
+            size_t buckets = std::max(static_cast<size_t>(header.table_size), static_cast<size_t>(header.count / _max_load_factor) + 1);
+            vector<Index, IndexAllocator>(Sizing::fit_size(buckets), npos, table.get_allocator()).swap(table);
+            sizing.resize(table.size());
+            nodes.clear();
+            nodes.reserve(static_cast<size_t>(header.count));
+            for (uint64_t i = 0; i < header.count; i++) {
+                size_t hash_value = static_cast<size_t>(in.get<uint64_t>());
+                Index& bucket = table[sizing.index(hash_value)];
+                Index node = static_cast<Index>(nodes.size());
+                nodes.emplace_back(bucket);
+                StreamCodec<Value>::read(in, nodes[node].value);
+                set_node_hash(node, hash_value);
+                bucket = node;
+            }
+            in.finish();
+            _size = static_cast<size_t>(header.count);
+            _current_load_factor = static_cast<float>(_size) / table.size();
+        }
+
+        // inserts the count values starting at first into a table that is empty and already big enough for them, on
+        // up to threads threads. every value gets a node up front, and the node of a value whose key is already in its
+        // bucket goes on the free list afterwards
+        template <class ForwardIt>
+        void bulk_insert(ForwardIt first, size_t count, unsigned threads) {
+            if (count >= npos) throw std::length_error("separate chaining table node pool is full");
+            nodes.assign(count, Node(npos));
+            SharedBuckets buckets = shared_buckets(table.size(), threads);
+            vector<Index> dropped;
+            std::mutex dropped_mutex;
+            parallel_for(count, threads, [&](size_t begin, size_t end) {
+                ForwardIt it = std::next(first, begin);
+                vector<Index> duplicates;
+                for (Index node = static_cast<Index>(begin); node < end; node++, ++it) {
+                    nodes[node].value = Value(*it);
+                    const Key& key = Slot::key(nodes[node].value);
+                    size_t hash_value = Hash{}(key);
+                    set_node_hash(node, hash_value);
+                    std::atomic<Index>& head = buckets[sizing.index(hash_value)];
+
+                    // the chain below a head never changes, so after a lost race only the nodes linked since need checking
+                    Index first_node = head.load(std::memory_order_acquire), checked = npos;
+                    for (;;) {
+                        Index other = first_node;
+                        while (other != checked && !matches(other, key, hash_value)) other = nodes[other].next;
+                        if (other != checked) {
+                            duplicates.push_back(node);
+                            break;
+                        }
+                        nodes[node].next = first_node;
+                        if (head.compare_exchange_weak(first_node, node, std::memory_order_acq_rel, std::memory_order_acquire)) break;
+                        checked = nodes[node].next;
+                    }
+                }
+                std::lock_guard<std::mutex> lock(dropped_mutex);
+                dropped.insert(dropped.end(), duplicates.begin(), duplicates.end());
+            });
+            publish_buckets(buckets, threads);
+
+            for (Index node : dropped) {
+                nodes[node].value = Value{};
+                nodes[node].next = free_list;
+                free_list = node;
+            }
+            _size = count - dropped.size();
+            _current_load_factor = static_cast<float>(_size) / table.size();
         }
-        
-        bool insert(const Key& value) { // returns true on successful insert, false on failed insert
-            if (contains(value)) return false;
+
+        // grows to num_buckets, incrementally if enabled. a rehash still in progress is finished first
+        void grow(size_t num_buckets) {
+            finish_rehash();
+            if (_rehash_step == 0) {
+                rehash(num_buckets);
+                return;
+            }
+
+            this->count_rehash();
+            vector<Index, IndexAllocator> new_table(Sizing::valid_size(num_buckets), npos, table.get_allocator());
+            table.swap(new_table);
+            old_table.swap(new_table);
+            old_sizing = sizing;
+            sizing.resize(table.size());
+            migrated = 0;
+            _current_load_factor = static_cast<float>(_size) / table.size();
+            // at least _rehash_step, and enough that the old buckets are gone before inserts alone can fill the new ones
+            float headroom = std::max(1.0f, table.size() * _max_load_factor - _size);
+            migration_step = std::max(_rehash_step, static_cast<size_t>(std::ceil(old_table.size() / headroom)));
+            migrate(migration_step);
+        }
+
+        // takes a node off the free list, or grows the pool by one, and constructs its value from args
+        template <class... Args>
+        Index allocate_node(Index next, Args&&... args) {
+            if (free_list != npos) {
+                Index node = free_list;
+                free_list = nodes[node].next;
+                nodes[node].value = Value(std::forward<Args>(args)...);
+                nodes[node].next = next;
+                return node;
+            }
+            if (nodes.size() == npos) throw std::length_error("separate chaining table node pool is full");
+            nodes.emplace_back(next, std::forward<Args>(args)...);
+            return static_cast<Index>(nodes.size() - 1);
+        }
+
+        // searches key's bucket once and, if key is absent, constructs a value from args at the front of it. returns an
+        // iterator to the value holding key and whether an insert happened. args may refer to key, they are only used
+        // at the end.
+        template <class K, class... Args>
+        std::pair<Iterator<false>, bool> emplace_hashed(const K& key, size_t hash_value, Args&&... args) {
+            if (is_rehashing()) migrate(migration_step);
+            auto [bucket, existing] = locate(key, hash_value);
+            if (existing != npos) return {Iterator<false>(this, bucket, existing), false};
 
             // rehash check
             float load_factor_check = static_cast<float>(_size + 1) / table.size();
             if (load_factor_check > _max_load_factor)
-                rehash(find_next_prime(table.size()));
+                grow(Sizing::next_size(table.size()));
 
             // perform insert
-            size_t index = Hash{}(value) % table.size();
-            table.at(index).push_front(value);
+            size_t index = sizing.index(hash_value);
+            Index node = allocate_node(table[index], std::forward<Args>(args)...);
+            set_node_hash(node, hash_value);
+            table[index] = node;
             _size++;
             _current_load_factor = static_cast<float>(_size) / table.size();
 
-            return true;
+            return {Iterator<false>(this, index, node), true};
         }
 
-        size_t remove(const Key& value) { // returns 1 on successful removal, 0 on failed removal
-            if (!contains(value)) return 0;
+        // removes key, whose hash has already been computed. returns 1 on successful removal, 0 on failed removal
+        template <class K>
+        size_t remove_hashed(const K& key, size_t hash_value) {
+            if (is_rehashing()) migrate(migration_step);
+            size_t probes = 0, removed = unlink(key, hash_value, &table[sizing.index(hash_value)], probes);
+            if (!removed && is_rehashing()) {
+                size_t index = old_sizing.index(hash_value);
+                if (index >= migrated) removed = unlink(key, hash_value, &old_table[index], probes);
+            }
+            this->count_search(removed != 0, probes);
+            return removed;
+        }
 
-            // perform removal
-            size_t index = Hash{}(value) % table.size();
-            table.at(index).remove(value);
-            _size--;
-            _current_load_factor = static_cast<float>(_size) / table.size();
+        // hashes a group of keys into hashes, then prefetches in two passes: the bucket of each key, then the first node
+        // of each bucket, whose index is only known once the bucket has been read
+        void prefetch_group(const Key* keys, size_t count, size_t* hashes) const {
+            for (size_t i = 0; i < count; i++) {
+                hashes[i] = Hash{}(keys[i]);
+                prefetch(&table[sizing.index(hashes[i])]);
+            }
+            for (size_t i = 0; i < count; i++) {
+                Index node = table[sizing.index(hashes[i])];
+                if (node != npos) prefetch(&nodes[node]);
+            }
+        }
 
-            return 1;
+    public:
+        // constructors
+        SeparateChainingTable() : SeparateChainingTable(11) {}
+        explicit SeparateChainingTable(size_t size, const Allocator& allocator = Allocator())
+            : table(Sizing::valid_size(size), npos, IndexAllocator(allocator)), nodes(NodeAllocator(allocator)), free_list{npos},
+              _size{0}, _current_load_factor{0.0}, _max_load_factor{1.0}, sizing{}, old_table(IndexAllocator(allocator)), old_sizing{},
+              migrated{0}, migration_step{0}, _rehash_step{0}, _rehash_threads{1} {
+            sizing.resize(table.size());
         }
 
-        // lookup
-        bool contains(const Key& value) const {
-            size_t index = Hash{}(value) % table.size();
-            for (Key key : table.at(index)) {
-                if (key == value) return true;
+        Allocator get_allocator() const { return Allocator(nodes.get_allocator()); }
+
+        // capacity
+        bool is_empty() const { return _size == 0; }
+        size_t size() const { return _size; }
+
+        // grows the buckets, with a single rehash, and the node pool so that count values fit under the current max
+        // load factor without another rehash or pool reallocation. never shrinks either
+        void reserve(size_t count) {
+            size_t buckets = Sizing::fit_size(static_cast<size_t>(count / static_cast<double>(_max_load_factor)) + 1);
+            if (buckets > table.size()) rehash(buckets);
+            if (count < npos) nodes.reserve(count);
+        }
+        // rehashes down to the fewest buckets that hold the values under the max load factor, and compacts the node
+        // pool to exactly the nodes in use. pointers to values are not kept
+        void shrink_to_fit() {
+            rehash(Sizing::fit_size(static_cast<size_t>(_size / static_cast<double>(_max_load_factor)) + 1));
+            compact_nodes();
+        }
+
+        // forward iterator over the values, bucket by bucket. inserts, remove(), rehashes and the like invalidate every
+        // iterator, erase() only the one erased
+        template <bool Const>
+        class Iterator {
+            private:
+                using Owner = std::conditional_t<Const, const SeparateChainingTable, SeparateChainingTable>;
+                Owner* owner;
+                size_t bucket; // see bucket_total()
+                Index node;
+
+                void skip_empty() {
+                    while (node == npos && ++bucket < owner->bucket_total()) node = owner->head(bucket);
+                }
+
+                friend class SeparateChainingTable;
+
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = Value;
+                using difference_type = std::ptrdiff_t;
+                // map iterators hand out a MapReference, so their keys are read only
+                using reference = std::conditional_t<Const, typename Slot::const_reference, typename Slot::reference>;
+                using pointer = std::conditional_t<std::is_reference_v<reference>, std::remove_reference_t<reference>*, ArrowProxy<reference>>;
+
+                Iterator() : owner{nullptr}, bucket{0}, node{npos} {}
+                Iterator(Owner* owner, size_t bucket, Index node) : owner{owner}, bucket{bucket}, node{node} {}
+                // the first value in or after bucket
+                Iterator(Owner* owner, size_t bucket)
+                    : owner{owner}, bucket{bucket}, node{bucket < owner->bucket_total() ? owner->head(bucket) : npos} { skip_empty(); }
+                Iterator(const Iterator&) = default;
+                Iterator& operator=(const Iterator&) = default;
+                operator Iterator<true>() const { return Iterator<true>(owner, bucket, node); }
+
+                reference operator*() const { return owner->nodes[node].value; }
+                pointer operator->() const {
+                    if constexpr (std::is_reference_v<reference>) return &owner->nodes[node].value;
+                    else return pointer{**this};
+                }
+                Iterator& operator++() {
+                    node = owner->nodes[node].next;
+                    skip_empty();
+                    return *this;
+                }
+                Iterator operator++(int) {
+                    Iterator previous = *this;
+                    ++*this;
+                    return previous;
+                }
+                bool operator==(const Iterator& other) const { return bucket == other.bucket && node == other.node; }
+                bool operator!=(const Iterator& other) const { return !(*this == other); }
+        };
+        using iterator = Iterator<false>;
+        using const_iterator = Iterator<true>;
+
+        // iterators
+        iterator begin() { return iterator(this, 0); }
+        iterator end() { return iterator(this, bucket_total(), npos); }
+        const_iterator begin() const { return const_iterator(this, 0); }
+        const_iterator end() const { return const_iterator(this, bucket_total(), npos); }
+        const_iterator cbegin() const { return begin(); }
+        const_iterator cend() const { return end(); }
+
+        // calls f(value) for every value, in one pass over the node pool. f must not change the table
+        template <class F>
+        void for_each(F f) const {
+            vector<bool> free = free_nodes();
+            for (size_t node = 0; node < nodes.size(); node++) {
+                if (!free[node]) f(nodes[node].value);
+            }
+        }
+
+        // moves every value out in one pass over the node pool, leaving the table empty with its current buckets
+        vector<Value> extract_all() {
+            vector<bool> free = free_nodes();
+            vector<Value> values;
+            values.reserve(_size);
+            for (size_t node = 0; node < nodes.size(); node++) {
+                if (!free[node]) values.push_back(std::move(nodes[node].value));
+            }
+            make_empty();
+            return values;
+        }
+
+        // modifiers
+        void make_empty() { 
+            table.assign(table.size(), npos);
+            old_table.clear();
+            nodes.clear();
+            free_list = npos;
+            _size = 0;
+            _current_load_factor = 0.0;
+        }
+
+        size_t remove(const Key& key) { return remove<Key, true>(key); } // returns 1 on successful removal, 0 on failed removal
+        template <class K, bool Enable = transparent<K>, class = std::enable_if_t<Enable>>
+        size_t remove(const K& key) { return remove_hashed(key, Hash{}(key)); }
+        // with hash_value already computed, it must be Hash{}(key)
+        size_t remove(const Key& key, size_t hash_value) { return remove<Key, true>(key, hash_value); }
+        template <class K, bool Enable = transparent<K>, class = std::enable_if_t<Enable>>
+        size_t remove(const K& key, size_t hash_value) { return remove_hashed(key, hash_value); }
+
+        // removes the value at position, returns the iterator to the value after it. never rehashes, so the other
+        // iterators stay valid
+        iterator erase(const_iterator position) {
+            iterator next(this, position.bucket, position.node);
+            ++next;
+            Index* link = &head(position.bucket);
+            while (*link != position.node) link = &nodes[*link].next;
+            release(link);
+            return next;
+        }
+
+        // removes each of keys[0, count), returns how many were in the table
+        size_t remove_batch(const Key* keys, size_t count) {
+            size_t hashes[prefetch_group_size];
+            size_t removed = 0;
+            for (size_t group = 0; group < count; group += prefetch_group_size) {
+                size_t group_size = std::min(prefetch_group_size, count - group);
+                prefetch_group(keys + group, group_size, hashes);
+                for (size_t i = 0; i < group_size; i++) removed += remove_hashed(keys[group + i], hashes[i]);
             }
+            return removed;
+        }
 
-            return false;
+        // lookup
+        bool contains(const Key& key) const { return contains<Key, true>(key); }
+        template <class K, bool Enable = transparent<K>, class = std::enable_if_t<Enable>>
+        bool contains(const K& key) const {
+            return find_value(key, Hash{}(key)) != nullptr;
+        }
+        // with hash_value already computed (kept from another table, or sent along with the key), it must be Hash{}(key)
+        bool contains(const Key& key, size_t hash_value) const { return contains<Key, true>(key, hash_value); }
+        template <class K, bool Enable = transparent<K>, class = std::enable_if_t<Enable>>
+        bool contains(const K& key, size_t hash_value) const {
+            return find_value(key, hash_value) != nullptr;
         }
 
-        // bucket interface
+        // results[i] = contains(keys[i]) for each of keys[0, count), returns how many were found
+        size_t contains_batch(const Key* keys, size_t count, bool* results) const {
+            size_t hashes[prefetch_group_size];
+            size_t found = 0;
+            for (size_t group = 0; group < count; group += prefetch_group_size) {
+                size_t group_size = std::min(prefetch_group_size, count - group);
+                prefetch_group(keys + group, group_size, hashes);
+                for (size_t i = 0; i < group_size; i++) {
+                    results[group + i] = find_value(keys[group + i], hashes[i]) != nullptr;
+                    found += results[group + i];
+                }
+            }
+            return found;
+        }
+
+        // bucket interface. while rehashing incrementally these describe the new buckets, keys not yet relinked from the
+        // old ones aren't counted in any bucket
         size_t bucket_count() const { return table.size(); }
         size_t bucket_size(size_t index) const {
             if (index >= table.size()) throw std::out_of_range("specified bucket is out of bounds");
 
-            return table.at(index).size();
+            size_t count = 0;
+            for (Index node = table[index]; node != npos; node = nodes[node].next) count++;
+            return count;
         }
-        size_t bucket(const Key& value) const { return Hash{}(value) % table.size(); }
+        size_t bucket(const Key& key) const { return sizing.index(Hash{}(key)); }
 
         // hash policy
         float load_factor() const { return _current_load_factor; }
@@ -111,26 +667,85 @@ class HashTable {
             if (max <= 0) throw std::invalid_argument("invalid max load factor value");
             _max_load_factor = max;
             if (_current_load_factor > _max_load_factor) {
-                rehash(find_next_prime(table.size()));
+                rehash(Sizing::next_size(table.size()));
             }
         }
 
+        // incremental rehash. with a step of n, growing the table only allocates the new buckets, then every insert and
+        // remove relinks at least the next n of the old ones (more if needed to be done before the next growth), so no
+        // single call pays for the whole rehash. lookups check both until it is done without relinking anything, so
+        // const calls stay read only. a step of 0 (the default) rehashes all at once, setting it finishes any rehash in
+        // progress
+        size_t incremental_rehash() const { return _rehash_step; }
+        void incremental_rehash(size_t step) {
+            if (step == 0) finish_rehash();
+            _rehash_step = step;
+        }
+        bool is_rehashing() const { return !old_table.empty(); }
+        // fraction of the old buckets relinked so far, 1 when no rehash is in progress
+        float rehash_progress() const { return is_rehashing() ? static_cast<float>(migrated) / old_table.size() : 1.0f; }
+        void finish_rehash() { migrate(old_table.size()); }
+
+        // parallel rehash. rehashing a table of at least 2 * parallel_grain buckets spreads the relinking over up to
+        // threads threads, each taking the chains of its own range of old buckets. 1 (the default) keeps it on the
+        // calling thread. the order of keys within a bucket then depends on how the threads raced
+        unsigned rehash_threads() const { return _rehash_threads; }
+        void rehash_threads(unsigned threads) {
+            if (threads == 0) throw std::invalid_argument("rehash needs at least one thread");
+            _rehash_threads = threads;
+        }
+
+        // always all at once, finishing any incremental rehash in progress first
         void rehash(size_t num_buckets) {
+            finish_rehash();
             if (num_buckets == table.size()) return; // nothing to do
             if (_size > num_buckets * _max_load_factor) 
                 num_buckets = _size / _max_load_factor; // minimum number of buckets needed if passed something that will cause rehash
+            num_buckets = Sizing::valid_size(num_buckets);
+            if (num_buckets == table.size()) return;
+            this->count_rehash();
+            [[maybe_unused]] auto timer = this->time_rehash();
 
-            // save old values and reinsert them
-            vector<list<Key>> old_table = table;
-            this->table = vector<list<Key>>{num_buckets};
-            _size = 0;
-            _current_load_factor = 0;
+            // swap the old buckets out and relink their nodes into the new buckets
+            vector<Index, IndexAllocator> old_buckets(num_buckets, npos, table.get_allocator());
+            table.swap(old_buckets);
+            sizing.resize(table.size());
 
-            for (list bucket : old_table) {
-                for (Key key : bucket) {
-                    insert(key); // _size and _current_load_factor will be properly updated here
+            if (_rehash_threads > 1 && old_buckets.size() >= 2 * parallel_grain) parallel_relink(old_buckets);
+            else for (Index bucket : old_buckets) relink(bucket);
+            _current_load_factor = static_cast<float>(_size) / table.size();
+        }
+
+        // statistics, with the CollectStats policy only (see hashtable_policies.h). chain_lengths covers the buckets of
+        // table (not the old ones of an incremental rehash), the counters everything since construction or
+        // reset_stats(). O(bucket count + size)
+        TableStats stats() const {
+            static_assert(Stats::enabled, "stats() needs the CollectStats policy");
+            TableStats result;
+            this->read_counters(result);
+            for (Index bucket : table) {
+                size_t length = 0;
+                for (Index node = bucket; node != npos; node = nodes[node].next) length++;
+                if (length >= result.chain_lengths.size()) result.chain_lengths.resize(length + 1);
+                result.chain_lengths[length]++;
+            }
+            result.bytes_allocated = (table.capacity() + old_table.capacity()) * sizeof(Index) + nodes.capacity() * sizeof(Node);
+            return result;
+        }
+        void reset_stats() { this->reset_counters(); }
+
+        // serialization, see StreamCodec in hashtable_policies.h. writes a header, then bucket by bucket each value's
+        // hash and encoding. HashTable::read and HashMap::read load it back
+        void write(std::ostream& os) const {
+            StreamWriter out(os);
+            write_stream_header(out, {_size, table.size(), _max_load_factor, Hash{}(Key{})});
+            for (size_t bucket = 0; bucket < bucket_total(); bucket++) {
+                for (Index node = head(bucket); node != npos; node = nodes[node].next) {
+                    out.put(static_cast<uint64_t>(node_hash(node)));
+                    StreamCodec<Value>::write(out, nodes[node].value);
                 }
             }
+            out.flush();
         }
 
         // visualization
@@ -140,14 +755,24 @@ class HashTable {
                 return;
             }
 
-            for (list bucket : table) {
-                if (bucket.size() != 0) {
-                    os << this->bucket(bucket.front()) << ": [";
-                    for (Key key : bucket) {
-                        if (key == bucket.back()) 
-                            os << key;
-                        else 
-                            os << key << ", ";
+            for (size_t index = 0; index < table.size(); index++) {
+                if (table[index] != npos) {
+                    os << index << ": [";
+                    for (Index node = table[index]; node != npos; node = nodes[node].next) {
+                        if (node != table[index])
+                            os << ", ";
+                        Slot::print(os, nodes[node].value);
+                    }
+                    os << "]" << endl;
+                }
+            }
+            for (size_t index = migrated; index < old_table.size(); index++) { // not relinked yet
+                if (old_table[index] != npos) {
+                    os << "old " << index << ": [";
+                    for (Index node = old_table[index]; node != npos; node = nodes[node].next) {
+                        if (node != old_table[index])
+                            os << ", ";
+                        Slot::print(os, nodes[node].value);
                     }
                     os << "]" << endl;
                 }
@@ -157,3 +782,203 @@ class HashTable {
         // FOR TESTING BUCKET INTERFACE METHODS
         size_t hash(const Key& value) { return Hash{}(value); } 
 };
+
+template <class Key, class Hash=std::hash<Key>, class KeyEqual=std::equal_to<Key>, class Sizing=PrimeModuloSizing,
+          class Allocator=std::allocator<Key>, class HashCaching=RecomputeHashes,
+          class Stats=NoStats>
+class HashTable : public SeparateChainingTable<Key, SetSlot<Key>, Hash, KeyEqual, Sizing, Allocator, HashCaching, Stats> {
+
+    private:
+        using Base = SeparateChainingTable<Key, SetSlot<Key>, Hash, KeyEqual, Sizing, Allocator, HashCaching, Stats>;
+
+    public:
+        using Base::Base;
+
+        // keys can't be changed in place, so every iterator is a const_iterator
+        using iterator = typename Base::const_iterator;
+        using const_iterator = typename Base::const_iterator;
+
+        // builds the table from the keys in [first, last) on up to threads threads, dropping duplicates. the table is
+        // sized for all of them up front so nothing is rehashed along the way
+        template <class ForwardIt, class = std::enable_if_t<!std::is_integral_v<ForwardIt>>>
+        HashTable(ForwardIt first, ForwardIt last, unsigned threads = default_thread_count(), const Allocator& allocator = Allocator())
+            : Base(Base::size_for(static_cast<size_t>(std::distance(first, last))), allocator) {
+            this->bulk_insert(first, static_cast<size_t>(std::distance(first, last)), threads);
+        }
+
+        // modifiers
+        bool insert(const Key& value) { return this->emplace_hashed(value, Hash{}(value), value).second; } // returns true on successful insert, false on failed insert
+        bool insert(Key&& value) {
+            size_t hash_value = Hash{}(value);
+            return this->emplace_hashed(value, hash_value, std::move(value)).second;
+        }
+        // inserts a key given as any type Hash and KeyEqual accept, a Key is only built from it if it isn't present
+        template <class K, bool Enable = Base::template transparent<K>, class = std::enable_if_t<Enable>>
+        bool insert(const K& value) { return this->emplace_hashed(value, Hash{}(value), value).second; }
+
+        // with hash_value already computed, it must be Hash{}(value)
+        bool insert(const Key& value, size_t hash_value) { return this->emplace_hashed(value, hash_value, value).second; }
+        bool insert(Key&& value, size_t hash_value) { return this->emplace_hashed(value, hash_value, std::move(value)).second; }
+        template <class K, bool Enable = Base::template transparent<K>, class = std::enable_if_t<Enable>>
+        bool insert(const K& value, size_t hash_value) { return this->emplace_hashed(value, hash_value, value).second; }
+
+        // inserts each of keys[0, count), returns how many were not already in the table
+        size_t insert_batch(const Key* keys, size_t count) {
+            size_t hashes[prefetch_group_size];
+            size_t inserted = 0;
+            for (size_t group = 0; group < count; group += prefetch_group_size) {
+                size_t group_size = std::min(prefetch_group_size, count - group);
+                this->prefetch_group(keys + group, group_size, hashes);
+                for (size_t i = 0; i < group_size; i++)
+                    inserted += this->emplace_hashed(keys[group + i], hashes[i], keys[group + i]).second;
+            }
+            return inserted;
+        }
+
+        const_iterator erase(const_iterator position) { return Base::erase(position); }
+
+        // iterators
+        const_iterator begin() const { return Base::cbegin(); }
+        const_iterator end() const { return Base::cend(); }
+
+        // lookup. end() if key is not in the table
+        const_iterator find(const Key& key) const { return find<Key, true>(key); }
+        template <class K, bool Enable = Base::template transparent<K>, class = std::enable_if_t<Enable>>
+        const_iterator find(const K& key) const {
+            auto [bucket, node] = this->locate(key, Hash{}(key));
+            return const_iterator(this, bucket, node);
+        }
+
+        // reads what write() wrote to in into a new table, see read_stream()
+        static HashTable read(std::istream& in, const Allocator& allocator = Allocator()) {
+            HashTable table(1, allocator);
+            table.read_stream(in);
+            return table;
+        }
+};
+
+template <class Key, class T, class Hash=std::hash<Key>, class KeyEqual=std::equal_to<Key>, class Sizing=PrimeModuloSizing,
+          class Allocator=std::allocator<std::pair<const Key, T>>, class HashCaching=RecomputeHashes,
+          class Stats=NoStats>
+class HashMap : public SeparateChainingTable<Key, MapSlot<Key, T>, Hash, KeyEqual, Sizing, Allocator, HashCaching, Stats> {
+
+    private:
+        using Base = SeparateChainingTable<Key, MapSlot<Key, T>, Hash, KeyEqual, Sizing, Allocator, HashCaching, Stats>;
+
+        template <class K>
+        static constexpr bool transparent = Base::template transparent<K>;
+
+        template <class K>
+        const T* find_mapped(const K& key, size_t hash_value) const {
+            auto value = this->find_value(key, hash_value);
+            return value ? &value->second : nullptr;
+        }
+        template <class K>
+        const T* find_mapped(const K& key) const { return find_mapped(key, Hash{}(key)); }
+
+        template <class K, class... Args>
+        std::pair<T*, bool> try_emplace_key(K&& key, Args&&... args) {
+            size_t hash_value = Hash{}(key);
+            auto [it, inserted] = this->emplace_hashed(key, hash_value, std::piecewise_construct,
+                std::forward_as_tuple(std::forward<K>(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+            return {&(*it).second, inserted};
+        }
+
+    public:
+        using Base::Base;
+
+        using iterator = typename Base::iterator;
+        using const_iterator = typename Base::const_iterator;
+
+        // builds the map from the key/mapped value pairs in [first, last) on up to threads threads, dropping duplicate
+        // keys. the table is sized for all of them up front so nothing is rehashed along the way
+        template <class ForwardIt, class = std::enable_if_t<!std::is_integral_v<ForwardIt>>>
+        HashMap(ForwardIt first, ForwardIt last, unsigned threads = default_thread_count(), const Allocator& allocator = Allocator())
+            : Base(Base::size_for(static_cast<size_t>(std::distance(first, last))), allocator) {
+            this->bulk_insert(first, static_cast<size_t>(std::distance(first, last)), threads);
+        }
+
+        // lookup. nullptr if key is not in the map
+        T* find(const Key& key) { return find<Key, true>(key); }
+        const T* find(const Key& key) const { return find<Key, true>(key); }
+        template <class K, bool Enable = transparent<K>, class = std::enable_if_t<Enable>>
+        T* find(const K& key) { return const_cast<T*>(find_mapped(key)); }
+        template <class K, bool Enable = transparent<K>, class = std::enable_if_t<Enable>>
+        const T* find(const K& key) const { return find_mapped(key); }
+        // with hash_value already computed, it must be Hash{}(key)
+        T* find(const Key& key, size_t hash_value) { return find<Key, true>(key, hash_value); }
+        const T* find(const Key& key, size_t hash_value) const { return find<Key, true>(key, hash_value); }
+        template <class K, bool Enable = transparent<K>, class = std::enable_if_t<Enable>>
+        T* find(const K& key, size_t hash_value) { return const_cast<T*>(find_mapped(key, hash_value)); }
+        template <class K, bool Enable = transparent<K>, class = std::enable_if_t<Enable>>
+        const T* find(const K& key, size_t hash_value) const { return find_mapped(key, hash_value); }
+
+        // iterator to the entry with key, end() if key is not in the map. for erase() and anything else that takes one
+        iterator find_iterator(const Key& key) { return find_iterator<Key, true>(key); }
+        const_iterator find_iterator(const Key& key) const { return find_iterator<Key, true>(key); }
+        template <class K, bool Enable = transparent<K>, class = std::enable_if_t<Enable>>
+        iterator find_iterator(const K& key) {
+            auto [bucket, node] = this->locate(key, Hash{}(key));
+            return iterator(this, bucket, node);
+        }
+        template <class K, bool Enable = transparent<K>, class = std::enable_if_t<Enable>>
+        const_iterator find_iterator(const K& key) const {
+            auto [bucket, node] = this->locate(key, Hash{}(key));
+            return const_iterator(this, bucket, node);
+        }
+
+        // mapped value for key, default constructed and inserted if key is not in the map
+        T& operator[](const Key& key) { return *try_emplace(key).first; }
+        T& operator[](Key&& key) { return *try_emplace(std::move(key)).first; }
+
+        // modifiers. each returns the mapped value for key and whether an insert happened
+        bool insert(const Key& key, const T& value) { return try_emplace(key, value).second; } // returns true on successful insert, false on failed insert
+
+        // constructs a key/mapped value pair from args and inserts it if its key is not already in the map. returns an
+        // iterator to the pair with that key and whether an insert happened
+        template <class... Args>
+        std::pair<iterator, bool> emplace(Args&&... args) {
+            typename Base::Value value(std::forward<Args>(args)...);
+            size_t hash_value = Hash{}(value.first);
+            return this->emplace_hashed(value.first, hash_value, std::move(value));
+        }
+
+        // constructs the mapped value from args only if key is not already in the map
+        template <class... Args>
+        std::pair<T*, bool> try_emplace(const Key& key, Args&&... args) { return try_emplace_key(key, std::forward<Args>(args)...); }
+        template <class... Args>
+        std::pair<T*, bool> try_emplace(Key&& key, Args&&... args) { return try_emplace_key(std::move(key), std::forward<Args>(args)...); }
+
+        // inserts key with value, or assigns value to the existing mapped value
+        template <class M>
+        std::pair<T*, bool> insert_or_assign(const Key& key, M&& value) {
+            auto result = try_emplace(key, std::forward<M>(value));
+            if (!result.second) *result.first = std::forward<M>(value);
+            return result;
+        }
+        template <class M>
+        std::pair<T*, bool> insert_or_assign(Key&& key, M&& value) {
+            auto result = try_emplace(std::move(key), std::forward<M>(value));
+            if (!result.second) *result.first = std::forward<M>(value);
+            return result;
+        }
+
+        // reads what write() wrote to in into a new map, see read_stream()
+        static HashMap read(std::istream& in, const Allocator& allocator = Allocator()) {
+            HashMap map(1, allocator);
+            map.read_stream(in);
+            return map;
+        }
+};
+
+// HashTable and HashMap allocating from a std::pmr::memory_resource, for example a monotonic_buffer_resource released
+// all at once after the table is dropped
+namespace pmr {
+    template <class Key, class Hash=std::hash<Key>, class KeyEqual=std::equal_to<Key>, class Sizing=PrimeModuloSizing,
+              class HashCaching=RecomputeHashes, class Stats=NoStats>
+    using HashTable = ::HashTable<Key, Hash, KeyEqual, Sizing, std::pmr::polymorphic_allocator<Key>, HashCaching, Stats>;
+
+    template <class Key, class T, class Hash=std::hash<Key>, class KeyEqual=std::equal_to<Key>, class Sizing=PrimeModuloSizing,
+              class HashCaching=RecomputeHashes, class Stats=NoStats>
+    using HashMap = ::HashMap<Key, T, Hash, KeyEqual, Sizing, std::pmr::polymorphic_allocator<std::pair<const Key, T>>, HashCaching, Stats>;
+}
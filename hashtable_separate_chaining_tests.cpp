@@ -1,5 +1,8 @@
 #include "hashtable_separate_chaining.h"
 #include <sstream>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
 
 #define black   "\033[30m"
 #define red     "\033[31m"
@@ -53,6 +56,83 @@
   }\
 }
 
+// key type which counts how many times it is copied, used to check that rehashing moves keys
+struct CopyCountedKey {
+    static int copies;
+    int value;
+    CopyCountedKey(int value = 0) : value{value} {}
+    CopyCountedKey(const CopyCountedKey& other) : value{other.value} { copies++; }
+    CopyCountedKey(CopyCountedKey&& other) = default;
+    CopyCountedKey& operator=(const CopyCountedKey& other) { value = other.value; copies++; return *this; }
+    CopyCountedKey& operator=(CopyCountedKey&& other) = default;
+    bool operator==(const CopyCountedKey& other) const { return value == other.value; }
+};
+int CopyCountedKey::copies = 0;
+
+struct CopyCountedKeyHash {
+    size_t operator()(const CopyCountedKey& key) const { return std::hash<int>{}(key.value); }
+};
+
+// transparent string hash, lets tables of std::string be searched with std::string_view and const char*
+struct StringHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view value) const { return std::hash<std::string_view>{}(value); }
+};
+
+// allocator which counts the allocations made through it and all its rebound copies
+int allocation_count = 0;
+template <class T>
+struct CountingAllocator {
+    using value_type = T;
+    CountingAllocator() = default;
+    template <class U>
+    CountingAllocator(const CountingAllocator<U>&) {}
+    T* allocate(size_t n) { allocation_count++; return std::allocator<T>{}.allocate(n); }
+    void deallocate(T* p, size_t n) { std::allocator<T>{}.deallocate(p, n); }
+    template <class U>
+    bool operator==(const CountingAllocator<U>&) const { return true; }
+    template <class U>
+    bool operator!=(const CountingAllocator<U>&) const { return false; }
+};
+
+// string hash which counts its calls, used to check that cached hashes are not recomputed
+struct CountingStringHash {
+    static int calls;
+    size_t operator()(const std::string& value) const {
+        calls++;
+        return std::hash<std::string>{}(value);
+    }
+};
+int CountingStringHash::calls = 0;
+
+// sends every key to the same bucket
+struct CollidingHash {
+    size_t operator()(int) const { return 42; }
+};
+
+// whether it->first can be assigned through an iterator of type It, which would change a key under its table
+template <class It, class = void>
+struct assignable_key : std::false_type {};
+template <class It>
+struct assignable_key<It, std::void_t<decltype(std::declval<It&>()->first = std::declval<int>())>> : std::true_type {};
+
+// memory resource which counts what is allocated from and freed back to it
+struct CountingResource : std::pmr::memory_resource {
+    size_t allocations;
+    size_t deallocations;
+    CountingResource() : allocations{0}, deallocations{0} {}
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        allocations++;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        deallocations++;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
+
 int main() {
     // is_empty() / make_empty
     {
@@ -523,6 +603,625 @@ int main() {
       expect(charTable.load_factor() to_be static_cast<float>(23)/26); 
     }
 
+    // rehash moves keys instead of copying them
+    {
+        HashTable<CopyCountedKey, CopyCountedKeyHash> table;
+        for (int i = 0; i < 11; i++) table.insert(CopyCountedKey(i));
+        CopyCountedKey::copies = 0;
+        table.insert(CopyCountedKey(11)); // causes a rehash
+        expect(table.bucket_count() to_be 23);
+        expect(CopyCountedKey::copies <= 1); // at most the copy made by insert itself
+        for (int i = 0; i <= 11; i++) expect(table.contains(CopyCountedKey(i)) to_be true);
+        expect(table.size() to_be 12);
+
+        HashTable<std::string> stringTable;
+        for (int i = 0; i < 200; i++) stringTable.insert(std::string(40, 'a' + i % 26) + std::to_string(i));
+        expect(stringTable.size() to_be 200);
+        for (int i = 0; i < 200; i++) assert(stringTable.contains(std::string(40, 'a' + i % 26) + std::to_string(i)) to_be true);
+    }
+
+    // power of two sizing
+    {
+      HashTable<int, std::hash<int>, std::equal_to<int>, PowerOfTwoSizing> intTable;
+      expect(intTable.bucket_count() to_be 16);
+      expect(intTable.bucket(7) to_be (PowerOfTwoSizing::mix(intTable.hash(7)) & 15));
+      for (int i = 0; i < 16; i++) intTable.insert(i);
+      expect(intTable.bucket_count() to_be 16);
+      intTable.insert(16);
+      expect(intTable.bucket_count() to_be 32);
+      intTable.rehash(100);
+      expect(intTable.bucket_count() to_be 128);
+      for (int i = 0; i <= 16; i++) expect(intTable.contains(i) to_be true);
+      for (int i = 0; i <= 16; i++) expect(intTable.bucket_size(intTable.bucket(i)) >= 1);
+    }
+
+    // prime fastmod sizing
+    {
+      HashTable<int, std::hash<int>, std::equal_to<int>, PrimeFastModSizing> intTable;
+      expect(intTable.bucket_count() to_be 11);
+      expect(intTable.bucket(3) to_be 3);
+      expect(intTable.bucket(14) to_be 3);
+      for (int i = 0; i < 100; i++) intTable.insert(i);
+      expect(intTable.bucket_count() to_be 197);
+      for (size_t i = 0; i < 100; i++) expect(intTable.bucket(i) to_be i);
+      for (int i = 0; i < 100; i++) expect(intTable.contains(i) to_be true);
+      intTable.rehash(7); // shrinks to the minimum bucket count for the load factor
+      expect(intTable.bucket_count() to_be 100);
+      expect(intTable.bucket(150) to_be 50);
+    }
+
+    // HashMap - insert / find / operator[]
+    {
+      HashMap<std::string, int> map;
+      expect(map.is_empty() to_be true);
+      expect(map.find("one") to_be nullptr);
+      expect(map.insert("one", 1) to_be true);
+      expect(map.insert("one", 100) to_be false);
+      expect(map.size() to_be 1);
+      expect(map.find("one") not_to_be nullptr);
+      expect(*map.find("one") to_be 1);
+      expect(map.contains("one") to_be true);
+
+      map["two"] = 2;
+      expect(map.size() to_be 2);
+      expect(map["two"] to_be 2);
+      expect(map["three"] to_be 0); // default constructed on first access
+      expect(map.size() to_be 3);
+      map["three"] += 3;
+      expect(*map.find("three") to_be 3);
+
+      *map.find("one") = 11;
+      expect(map["one"] to_be 11);
+
+      const HashMap<std::string, int>& const_map = map;
+      expect(*const_map.find("two") to_be 2);
+      expect(const_map.find("four") to_be nullptr);
+
+      expect(map.remove("two") to_be 1);
+      expect(map.remove("two") to_be 0);
+      expect(map.find("two") to_be nullptr);
+      expect(map.size() to_be 2);
+
+      // growth keeps every key with its mapped value
+      HashMap<int, std::string> intMap;
+      for (int i = 0; i < 100; i++) intMap[i] = std::to_string(i);
+      expect(intMap.size() to_be 100);
+      for (int i = 0; i < 100; i++) assert(*intMap.find(i) to_be std::to_string(i));
+      for (int i = 0; i < 100; i += 2) intMap.remove(i);
+      for (int i = 0; i < 100; i++) assert((intMap.find(i) to_be nullptr) to_be (i % 2 == 0));
+    }
+
+    // HashMap - try_emplace / insert_or_assign
+    {
+      HashMap<int, std::string> map;
+      auto [value, inserted] = map.try_emplace(1, 3, 'x');
+      expect(inserted to_be true);
+      expect(*value to_be "xxx");
+      auto [existing, inserted_again] = map.try_emplace(1, 3, 'y');
+      expect(inserted_again to_be false);
+      expect(*existing to_be "xxx"); // mapped value is not constructed or changed when the key exists
+
+      auto [assigned, assign_inserted] = map.insert_or_assign(1, "assigned");
+      expect(assign_inserted to_be false);
+      expect(*assigned to_be "assigned");
+      expect(map.size() to_be 1);
+      auto [created, create_inserted] = map.insert_or_assign(2, "created");
+      expect(create_inserted to_be true);
+      expect(*created to_be "created");
+      expect(*map.find(2) to_be "created");
+      expect(map.size() to_be 2);
+
+      // emplace builds the whole pair, and leaves the existing one alone if the key is already there
+      auto [pair, emplaced] = map.emplace(3, "three");
+      expect(emplaced to_be true);
+      expect(pair->first to_be 3);
+      expect(pair->second to_be "three");
+      auto [kept, emplaced_again] = map.emplace(std::make_pair(3, std::string("other")));
+      expect(emplaced_again to_be false);
+      expect(kept->second to_be "three");
+      kept->second = "changed";
+      expect(*map.find(3) to_be "changed");
+      expect(map.size() to_be 3);
+
+      // find_iterator hands out an iterator to the entry, for erase()
+      auto found = map.find_iterator(2);
+      expect(found->second to_be "created");
+      expect((map.find_iterator(9) == map.end()) to_be true);
+      map.erase(found);
+      expect(map.find(2) to_be nullptr);
+      expect(map.size() to_be 2);
+    }
+
+    // heterogeneous lookup
+    {
+      HashTable<std::string, StringHash, std::equal_to<>> stringTable;
+      stringTable.insert("hello");
+      stringTable.insert("world");
+      std::string_view hello = "hello";
+      expect(stringTable.contains(hello) to_be true);
+      expect(stringTable.contains("world") to_be true);
+      expect(stringTable.contains(std::string_view("missing")) to_be false);
+      expect(stringTable.remove(std::string_view("world")) to_be 1);
+      expect(stringTable.contains("world") to_be false);
+      expect(stringTable.size() to_be 1);
+
+      HashMap<std::string, int, StringHash, std::equal_to<>> map;
+      map["key"] = 5;
+      expect(*map.find(std::string_view("key")) to_be 5);
+      expect(map.find("not a key") to_be nullptr);
+    }
+
+    // batch operations
+    {
+      std::vector<int> keys;
+      for (int i = 0; i < 1000; i++) keys.push_back(i * 3);
+      HashTable<int> intTable;
+      expect(intTable.insert_batch(keys.data(), keys.size()) to_be 1000);
+      expect(intTable.insert_batch(keys.data(), 10) to_be 0); // already there
+      expect(intTable.size() to_be 1000);
+
+      std::vector<int> probes;
+      for (int i = 0; i < 3000; i++) probes.push_back(i);
+      std::unique_ptr<bool[]> results(new bool[probes.size()]);
+      expect(intTable.contains_batch(probes.data(), probes.size(), results.get()) to_be 1000);
+      for (size_t i = 0; i < probes.size(); i++) assert(results[i] to_be (i % 3 == 0));
+
+      expect(intTable.remove_batch(probes.data(), 1500) to_be 500);
+      expect(intTable.size() to_be 500);
+      expect(intTable.contains_batch(probes.data(), probes.size(), results.get()) to_be 500);
+      for (size_t i = 0; i < probes.size(); i++) assert(results[i] to_be (i % 3 == 0 && i >= 1500));
+      expect(intTable.contains_batch(probes.data(), 0, results.get()) to_be 0);
+
+      HashMap<std::string, int> map;
+      map["a"] = 1;
+      map["b"] = 2;
+      std::string lookups[] = {"a", "c", "b"};
+      bool found[3];
+      expect(map.contains_batch(lookups, 3, found) to_be 2);
+      expect(found[1] to_be false);
+      expect(map.remove_batch(lookups, 3) to_be 2);
+      expect(map.is_empty() to_be true);
+    }
+
+    // node pool
+    {
+      using CountingTable = HashTable<int, std::hash<int>, std::equal_to<int>, PrimeModuloSizing, CountingAllocator<int>>;
+      CountingTable intTable;
+      for (int i = 0; i < 100; i++) intTable.insert(i);
+      for (int i = 0; i < 100; i += 2) intTable.remove(i);
+      int before = allocation_count;
+      for (int i = 0; i < 50; i++) expect(intTable.insert(1000 + i) to_be true); // reuses the removed nodes
+      for (int round = 0; round < 100; round++) { // churn never allocates
+        expect(intTable.remove(1000 + round % 50) to_be 1);
+        expect(intTable.insert(1000 + round % 50) to_be true);
+      }
+      expect(allocation_count to_be before);
+      expect(intTable.size() to_be 100);
+      for (int i = 1; i < 100; i += 2) assert(intTable.contains(i) to_be true);
+      for (int i = 0; i < 100; i += 2) assert(intTable.contains(i) to_be false);
+      for (int i = 0; i < 50; i++) assert(intTable.contains(1000 + i) to_be true);
+
+      HashMap<std::string, std::string> map;
+      map["a"] = std::string(100, 'a');
+      expect(map.remove("a") to_be 1);
+      map["b"] = "b"; // takes the node "a" was in
+      expect(*map.find("b") to_be "b");
+      expect(map.find("a") to_be nullptr);
+      expect(map.size() to_be 1);
+    }
+
+    // allocators
+    {
+      CountingResource resource;
+      pmr::HashTable<int> intTable(11, &resource);
+      expect(intTable.get_allocator().resource() to_be &resource);
+      for (int i = 0; i < 1000; i++) intTable.insert(i);
+      for (int i = 0; i < 1000; i++) assert(intTable.contains(i) to_be true);
+      expect((resource.allocations > 0) to_be true);
+      intTable.make_empty();
+      expect(intTable.is_empty() to_be true);
+
+      pmr::HashMap<std::string, int> map(11, &resource);
+      size_t before = resource.allocations;
+      for (int i = 0; i < 100; i++) map[std::to_string(i)] = i;
+      expect((resource.allocations > before) to_be true);
+      expect(*map.find("42") to_be 42);
+
+      // a table on a monotonic buffer is dropped without freeing anything, the buffer goes all at once
+      size_t freed = resource.deallocations;
+      {
+          std::pmr::monotonic_buffer_resource arena(&resource);
+          {
+              pmr::HashTable<int> scratch(11, &arena);
+              for (int i = 0; i < 10000; i++) scratch.insert(i);
+              expect(scratch.size() to_be 10000);
+          }
+          expect(resource.deallocations to_be freed);
+      }
+      expect((resource.deallocations > freed) to_be true);
+    }
+
+    // incremental rehash
+    {
+      HashTable<int> table;
+      expect(table.incremental_rehash() to_be 0);
+      table.incremental_rehash(1);
+      expect(table.is_rehashing() to_be false);
+      expect(table.rehash_progress() to_be 1.0f);
+
+      // grows the way it always does, but only the first old buckets are relinked in the insert that grew it
+      size_t buckets = table.bucket_count();
+      int next = 0;
+      while (table.bucket_count() == buckets) table.insert(next++);
+      expect(table.is_rehashing() to_be true);
+      expect((table.rehash_progress() < 1.0f) to_be true);
+      for (int i = 0; i < next; i++) assert(table.contains(i) to_be true);
+      expect(table.contains(next) to_be false);
+      expect(table.size() to_be static_cast<size_t>(next));
+
+      // keys still in the old buckets can be found, reinserted and removed
+      expect(table.insert(1) to_be false);
+      expect(table.remove(2) to_be 1);
+      expect(table.contains(2) to_be false);
+      expect(table.remove(2) to_be 0);
+
+      float progress = table.rehash_progress();
+      table.insert(1000);
+      expect((table.rehash_progress() > progress) to_be true);
+      while (table.is_rehashing()) table.insert(next++);
+      expect(table.rehash_progress() to_be 1.0f);
+      for (int i = 0; i < next; i++) assert(table.contains(i) to_be (i != 2));
+      expect(table.contains(1000) to_be true);
+
+      // explicit rehashes finish the one in progress first
+      table.incremental_rehash(3);
+      for (int i = next; i < 2000; i++) table.insert(i);
+      table.rehash(4001);
+      expect(table.is_rehashing() to_be false);
+      for (int i = 0; i < 2000; i++) assert(table.contains(i) to_be (i != 2));
+      expect(table.size() to_be 1999);
+
+      HashMap<int, int> map;
+      map.incremental_rehash(1);
+      for (int i = 0; i < 100; i++) map[i] = i * i;
+      for (int i = 0; i < 100; i++) assert(*map.find(i) to_be i * i);
+      map[3] = -3;
+      expect(*map.find(3) to_be -3);
+      map.make_empty();
+      expect(map.is_rehashing() to_be false);
+      expect(map.find(3) to_be nullptr);
+    }
+
+    // parallel rehash and bulk construction
+    {
+      // every key twice, duplicates are dropped and their nodes reused
+      vector<int> keys;
+      for (int i = 0; i < 100000; i++) keys.push_back(i % 60000);
+      HashTable<int> table(keys.begin(), keys.end(), 4);
+      expect(table.size() to_be 60000);
+      expect((table.load_factor() <= table.max_load_factor()) to_be true);
+      for (int i = 0; i < 70000; i++) assert(table.contains(i) to_be (i < 60000));
+      expect(table.insert(5) to_be false);
+      expect(table.insert(60000) to_be true);
+      size_t bucket_total = 0;
+      for (size_t i = 0; i < table.bucket_count(); i++) bucket_total += table.bucket_size(i);
+      expect(bucket_total to_be 60001);
+
+      HashTable<int> empty(keys.begin(), keys.begin(), 4);
+      expect(empty.is_empty() to_be true);
+
+      vector<std::string> words;
+      for (int i = 0; i < 50000; i++) words.push_back(std::to_string(i % 1000));
+      HashTable<std::string> wordTable(words.begin(), words.end(), 4);
+      expect(wordTable.size() to_be 1000);
+      expect(wordTable.contains("999") to_be true);
+
+      // rehashes spread over threads once the table is big enough
+      expect(table.rehash_threads() to_be 1);
+      expect_throw(table.rehash_threads(0), std::invalid_argument);
+      table.rehash_threads(4);
+      table.rehash(200000);
+      expect((table.bucket_count() >= 200000) to_be true);
+      for (int i = 0; i < 70000; i++) assert(table.contains(i) to_be (i <= 60000));
+      for (int i = 60001; i < 300000; i++) table.insert(i);
+      expect(table.size() to_be 300000);
+      for (int i = 0; i < 300000; i++) assert(table.contains(i) to_be true);
+    }
+
+    // cached hashes
+    {
+      // each key is hashed once, on insert. rehashes read the stored hashes
+      CountingStringHash::calls = 0;
+      HashTable<std::string, CountingStringHash, std::equal_to<std::string>, PrimeModuloSizing, std::allocator<std::string>, CacheHashes> table;
+      for (int i = 0; i < 1000; i++) table.insert(std::to_string(i));
+      expect(CountingStringHash::calls to_be 1000);
+      table.rehash(5000);
+      table.rehash_threads(4);
+      table.rehash(100000);
+      expect(CountingStringHash::calls to_be 1000);
+      for (int i = 0; i < 1000; i += 2) table.remove(std::to_string(i));
+      for (int i = 0; i < 1000; i++) assert(table.contains(std::to_string(i)) to_be (i % 2 == 1));
+
+      std::vector<std::string> words;
+      for (int i = 0; i < 50000; i++) words.push_back(std::to_string(i % 20000));
+      HashTable<std::string, std::hash<std::string>, std::equal_to<std::string>, PrimeModuloSizing, std::allocator<std::string>, CacheHashes> bulk(words.begin(), words.end(), 4);
+      expect(bulk.size() to_be 20000);
+      bulk.incremental_rehash(1);
+      for (int i = 20000; i < 40000; i++) bulk.insert(std::to_string(i));
+      for (int i = 0; i < 40000; i++) assert(bulk.contains(std::to_string(i)) to_be true);
+
+      pmr::HashMap<std::string, int, std::hash<std::string>, std::equal_to<std::string>, PrimeModuloSizing, CacheHashes> map;
+      for (int i = 0; i < 100; i++) map[std::to_string(i)] = i;
+      expect(*map.find("42") to_be 42);
+      expect(map.find("100") to_be nullptr);
+    }
+
+    // precomputed hashes
+    {
+      // a key parsed out of a buffer is looked up and inserted without building a std::string unless it is new
+      HashTable<std::string, StringHash, std::equal_to<>> table;
+      std::string_view parsed = "parsed";
+      size_t hash_value = StringHash{}(parsed);
+      expect(table.insert(parsed, hash_value) to_be true);
+      expect(table.insert(parsed) to_be false);
+      expect(table.insert(std::string("parsed"), hash_value) to_be false);
+      expect(table.contains(parsed, hash_value) to_be true);
+      expect(table.contains(std::string("parsed"), hash_value) to_be true);
+
+      // hashes kept from one table are good for another with the same Hash
+      HashTable<std::string, StringHash, std::equal_to<>> other;
+      std::vector<size_t> hashes;
+      for (int i = 0; i < 100; i++) {
+        std::string key = std::to_string(i);
+        hashes.push_back(StringHash{}(key));
+        table.insert(key, hashes.back());
+      }
+      for (int i = 0; i < 100; i++) other.insert(std::to_string(i), hashes[i]);
+      for (int i = 0; i < 100; i++) assert(other.contains(std::to_string(i), hashes[i]) to_be true);
+      expect(table.remove(parsed, hash_value) to_be 1);
+      expect(table.contains(parsed, hash_value) to_be false);
+      expect(table.remove("parsed", hash_value) to_be 0);
+      expect(table.size() to_be 100);
+
+      HashTable<int> ints;
+      size_t seven = std::hash<int>{}(7);
+      expect(ints.insert(7, seven) to_be true);
+      expect(ints.contains(7, seven) to_be true);
+      expect(ints.remove(7, seven) to_be 1);
+      expect(ints.is_empty() to_be true);
+
+      HashMap<std::string, int, StringHash, std::equal_to<>> map;
+      map["key"] = 5;
+      expect(*map.find(std::string_view("key"), StringHash{}("key")) to_be 5);
+      expect(*map.find(std::string("key"), StringHash{}("key")) to_be 5);
+      expect(map.find("missing", StringHash{}("missing")) to_be nullptr);
+    }
+
+    // runtime stats
+    {
+      HashTable<int, std::hash<int>, std::equal_to<int>, PrimeModuloSizing, std::allocator<int>, RecomputeHashes, CollectStats> table;
+      for (int i = 0; i < 100; i++) table.insert(i);
+      for (int i = 0; i < 100; i++) assert(table.contains(i) to_be true);
+      for (int i = 100; i < 150; i++) assert(table.contains(i) to_be false);
+
+      TableStats stats = table.stats();
+      expect(stats.hits to_be 100);
+      expect(stats.misses to_be 150);
+      expect((stats.rehashes >= 1) to_be true);
+      expect((stats.average_hit_probes() >= 1.0) to_be true);
+      expect(stats.tombstones to_be 0);
+      expect((stats.bytes_allocated >= table.bucket_count() * sizeof(uint32_t) + 100 * sizeof(int)) to_be true);
+      size_t buckets = 0, keys = 0;
+      for (size_t length = 0; length < stats.chain_lengths.size(); length++) {
+        buckets += stats.chain_lengths[length];
+        keys += length * stats.chain_lengths[length];
+      }
+      expect(buckets to_be table.bucket_count());
+      expect(keys to_be 100);
+
+      for (int i = 0; i < 10; i++) table.remove(i);
+      expect(table.remove(0) to_be 0);
+      expect(table.stats().hits to_be 110);
+      expect(table.stats().misses to_be 151);
+
+      std::stringstream ss;
+      table.stats().print_prometheus(ss);
+      expect(ss.str().find("hashtable_searches_total{result=\"miss\"} 151") != std::string::npos);
+      expect(ss.str().find("# TYPE hashtable_chain_length histogram") != std::string::npos);
+      expect(ss.str().find("hashtable_chain_length_sum 90") != std::string::npos);
+      expect(ss.str().find("hashtable_rehashes_total") != std::string::npos);
+
+      table.reset_stats();
+      expect(table.stats().hits to_be 0);
+      expect(table.stats().rehashes to_be 0);
+
+      // every key in one bucket
+      HashTable<int, CollidingHash, std::equal_to<int>, PrimeModuloSizing, std::allocator<int>, RecomputeHashes, CollectStats> colliding;
+      for (int i = 0; i < 20; i++) colliding.insert(i);
+      expect(colliding.contains(20) to_be false);
+      expect(colliding.stats().max_miss_probes to_be 20);
+      expect(colliding.stats().chain_lengths.size() to_be 21);
+
+      // incremental rehashes are counted when they start and timed as they go
+      HashMap<int, int, std::hash<int>, std::equal_to<int>, PrimeModuloSizing, std::allocator<std::pair<const int, int>>, CacheHashes,
+              CollectStats> map;
+      map.incremental_rehash(1);
+      for (int i = 0; i < 100; i++) map[i] = i;
+      expect((map.stats().rehashes >= 1) to_be true);
+      expect(*map.find(7) to_be 7);
+    }
+
+    // iterators
+    {
+      HashTable<int> table;
+      for (int i = 0; i < 100; i++) table.insert(i);
+      std::vector<int> seen(100, 0);
+      for (int key : table) seen[key]++;
+      for (int i = 0; i < 100; i++) assert(seen[i] to_be 1);
+      expect(std::distance(table.begin(), table.end()) to_be 100);
+
+      auto found = table.find(42);
+      expect((found != table.end()) to_be true);
+      expect(*found to_be 42);
+      expect((table.find(100) == table.end()) to_be true);
+
+      // erasing while walking keeps the rest of the walk valid
+      for (auto it = table.begin(); it != table.end(); ) {
+        if (*it % 2 == 0) it = table.erase(it);
+        else ++it;
+      }
+      expect(table.size() to_be 50);
+      for (int i = 0; i < 100; i++) assert(table.contains(i) to_be (i % 2 == 1));
+
+      // for_each and extract_all skip the nodes on the free list
+      int sum = 0;
+      table.for_each([&sum](int key) { sum += key; });
+      expect(sum to_be 2500);
+
+      std::vector<int> keys = table.extract_all();
+      expect(keys.size() to_be 50);
+      expect(table.is_empty() to_be true);
+      expect((table.begin() == table.end()) to_be true);
+      sum = 0;
+      for (int key : keys) sum += key;
+      expect(sum to_be 2500);
+
+      // map iterators reach the mapped values, all in one bucket here
+      HashMap<int, int, CollidingHash> map;
+      for (int i = 0; i < 20; i++) map[i] = i;
+      for (auto&& [key, value] : map) value = key * 2;
+      for (int i = 0; i < 20; i++) assert(*map.find(i) to_be i * 2);
+      // keys are read only through them, it->first = ... doesn't compile
+      expect((assignable_key<std::vector<std::pair<int, int>>::iterator>::value to_be true));
+      expect((assignable_key<decltype(map)::iterator>::value to_be false));
+      expect((assignable_key<decltype(map)::const_iterator>::value to_be false));
+      std::pair<int, int> copied = *map.begin();
+      expect(copied.second to_be copied.first * 2);
+      for (auto it = map.begin(); it != map.end(); ) {
+        if (it->first % 3 == 0) it = map.erase(it);
+        else ++it;
+      }
+      expect(map.size() to_be 13);
+      for (int i = 0; i < 20; i++) assert((map.find(i) != nullptr) to_be (i % 3 != 0));
+
+      // mid rehash the walk covers the buckets not relinked yet too
+      HashTable<std::string> incremental;
+      incremental.incremental_rehash(1);
+      for (int i = 0; i < 100; i++) incremental.insert(std::to_string(i));
+      expect(incremental.is_rehashing() to_be true);
+      size_t count = 0;
+      incremental.for_each([&count](const std::string&) { count++; });
+      expect(count to_be 100);
+      expect(std::distance(incremental.begin(), incremental.end()) to_be 100);
+      for (int i = 0; i < 100; i++) assert((incremental.find(std::to_string(i)) != incremental.end()) to_be true);
+      for (int i = 0; i < 100; i++) incremental.erase(incremental.find(std::to_string(i)));
+      expect(incremental.is_empty() to_be true);
+      expect((incremental.begin() == incremental.end()) to_be true);
+    }
+
+    // streaming
+    {
+      HashTable<std::string> table;
+      for (int i = 0; i < 2000; i++) table.insert("key " + std::to_string(i) + std::string(i % 40, 'x'));
+      for (int i = 0; i < 2000; i += 3) table.remove("key " + std::to_string(i) + std::string(i % 40, 'x'));
+      std::stringstream stream;
+      table.write(stream);
+      stream << "after";
+      auto loaded = HashTable<std::string>::read(stream);
+      expect(loaded.size() to_be table.size());
+      for (int i = 0; i < 2000; i++) assert(loaded.contains("key " + std::to_string(i) + std::string(i % 40, 'x')) to_be (i % 3 != 0));
+      expect(loaded.insert("new") to_be true); // a loaded table is an ordinary one
+      expect(loaded.insert("key 1x") to_be false);
+      std::string rest;
+      stream >> rest; // what follows the table in the stream is left for the caller
+      expect(rest to_be "after");
+
+      // maps, and a table in the middle of an incremental rehash
+      HashMap<std::string, int, std::hash<std::string>, std::equal_to<std::string>, PrimeModuloSizing, std::allocator<std::pair<const std::string, int>>, CacheHashes> map;
+      map.incremental_rehash(1);
+      for (int i = 0; i < 500; i++) map[std::to_string(i)] = i;
+      expect(map.is_rehashing() to_be true);
+      std::stringstream map_stream;
+      map.write(map_stream);
+      auto loaded_map = decltype(map)::read(map_stream);
+      expect(loaded_map.size() to_be 500);
+      for (int i = 0; i < 500; i++) assert(*loaded_map.find(std::to_string(i)) to_be i);
+
+      // a stream for another Hash, one cut short and one that isn't a table are refused
+      HashTable<int> ints;
+      for (int i = 0; i < 100; i++) ints.insert(i);
+      std::stringstream int_stream;
+      ints.write(int_stream);
+      std::string written = int_stream.str();
+      expect_throw((HashTable<int, CollidingHash>::read(int_stream)), std::runtime_error);
+      std::stringstream cut(written.substr(0, written.size() / 2));
+      expect_throw(HashTable<int>::read(cut), std::runtime_error);
+      std::stringstream text("not a table at all");
+      expect_throw(HashTable<int>::read(text), std::runtime_error);
+      std::stringstream whole(written);
+      expect(HashTable<int>::read(whole).size() to_be 100);
+    }
+
+    // capacity planning
+    {
+      HashTable<int> table;
+      table.reserve(1000);
+      size_t reserved = table.bucket_count();
+      expect((reserved > 1000) to_be true);
+      for (int i = 0; i < 1000; i++) table.insert(i);
+      expect(table.bucket_count() to_be reserved); // no rehash along the way
+      table.reserve(10); // never shrinks
+      expect(table.bucket_count() to_be reserved);
+
+      // shrinking also compacts the node pool, the free list is gone and new keys get new nodes
+      for (int i = 0; i < 900; i++) table.remove(i);
+      table.shrink_to_fit();
+      expect((table.bucket_count() < reserved) to_be true);
+      for (int i = 0; i < 1000; i++) assert(table.contains(i) to_be (i >= 900));
+      size_t count = 0;
+      table.for_each([&count](int) { count++; });
+      expect(count to_be 100);
+      for (int i = 0; i < 900; i++) table.insert(i);
+      expect(table.size() to_be 1000);
+      for (int i = 0; i < 1000; i++) assert(table.contains(i) to_be true);
+
+      // reserved bucket counts are prime, so keys sharing a factor still spread out
+      HashTable<int, std::hash<int>, std::equal_to<int>, PrimeModuloSizing, std::allocator<int>, RecomputeHashes, CollectStats> strided;
+      strided.reserve(1000);
+      size_t strided_buckets = strided.bucket_count();
+      for (int i = 0; i < 1000; i++) strided.insert(i * 2001);
+      expect(strided.bucket_count() to_be strided_buckets);
+      strided.reset_stats();
+      for (int i = 0; i < 1000; i++) assert(strided.contains(i * 2001) to_be true);
+      expect((strided.stats().max_hit_probes <= 2) to_be true);
+      for (int i = 0; i < 900; i++) strided.remove(i * 2001);
+      strided.shrink_to_fit();
+      strided.reset_stats();
+      for (int i = 900; i < 1000; i++) assert(strided.contains(i * 2001) to_be true);
+      expect((strided.stats().max_hit_probes <= 2) to_be true);
+
+      // so are the bucket counts of a table built from a range or read from a stream
+      std::vector<int> strided_keys;
+      for (int i = 0; i < 1000; i++) strided_keys.push_back(i * 1001);
+      HashTable<int, std::hash<int>, std::equal_to<int>, PrimeModuloSizing, std::allocator<int>, RecomputeHashes, CollectStats> ranged(
+          strided_keys.begin(), strided_keys.end());
+      expect(ranged.bucket_count() to_be 1009);
+      for (int i = 0; i < 1000; i++) assert(ranged.contains(i * 1001) to_be true);
+      expect((ranged.stats().max_hit_probes <= 2) to_be true);
+      std::stringstream strided_stream;
+      ranged.write(strided_stream);
+      auto reread = decltype(ranged)::read(strided_stream);
+      for (int i = 0; i < 1000; i++) assert(reread.contains(i * 1001) to_be true);
+      expect((reread.stats().max_hit_probes <= 2) to_be true);
+
+      // a map built from a range is sized once, duplicate keys are dropped
+      std::vector<std::pair<int, std::string>> pairs;
+      for (int i = 0; i < 1000; i++) pairs.emplace_back(i % 500, std::to_string(i));
+      HashMap<int, std::string> map(pairs.begin(), pairs.end());
+      expect(map.size() to_be 500);
+      for (int i = 0; i < 500; i++) assert((*map.find(i) == std::to_string(i) || *map.find(i) == std::to_string(i + 500)) to_be true);
+    }
+
     // print table
     {
       HashTable<int> intTable;
@@ -537,6 +1236,17 @@ int main() {
       intTable.print_table(ss);
       std::string expected = "2: [2]\n3: [3]\n";
       expect(ss.str() to_be expected);
+
+      intTable.insert(13);
+      std::stringstream collisionss;
+      intTable.print_table(collisionss);
+      expect(collisionss.str() to_be "2: [13, 2]\n3: [3]\n");
+
+      HashMap<int, std::string> map;
+      map[2] = "two";
+      std::stringstream mapss;
+      map.print_table(mapss);
+      expect(mapss.str() to_be "2: [2 => two]\n");
     }
 
     // all the above kind of test but commented out to hide output
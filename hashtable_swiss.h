@@ -0,0 +1,225 @@
+/*
+ *  Open addressing hashtable in the style of Swiss tables (Abseil's flat_hash_set). Alongside the keys is an array of
+ *  one byte control tags: empty, deleted, or the low 7 bits of the key's hash. A lookup compares a whole group of 16
+ *  tags at once (SSE2, or a scalar loop where that isn't available) and only touches keys whose tag matches, so most
+ *  failed comparisons never leave the control array. Max load factor is 7/8, sizes are powers of two.
+ *  Same insert/remove/contains/size/make_empty interface as the other HashTable headers.
+*/
+
+#pragma once
+#include <functional>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <iostream> // for print_table only
+#include "hashtable_policies.h"
+
+#if defined(__SSE2__) && !defined(HASHTABLE_NO_SIMD)
+#include <emmintrin.h>
+#define HASHTABLE_SWISS_SSE2 1
+#endif
+
+using std::vector, std::cout, std::endl;
+
+// 16 control bytes matched together. each match returns a bitmask with bit i set when byte i matches
+class ControlGroup {
+    public:
+        static constexpr size_t width = 16;
+
+        // control byte values. full slots hold 7 hash bits (0 to 127), so empty and deleted are the negative values
+        static constexpr int8_t EMPTY = -128;
+        static constexpr int8_t DELETED = -2;
+
+#ifdef HASHTABLE_SWISS_SSE2
+        explicit ControlGroup(const int8_t* control) : bytes{_mm_loadu_si128(reinterpret_cast<const __m128i*>(control))} {}
+#else
+        explicit ControlGroup(const int8_t* control) : bytes{} {
+            for (size_t i = 0; i < width; i++) bytes[i] = control[i];
+        }
+#endif
+
+        uint32_t match(int8_t tag) const {
+#ifdef HASHTABLE_SWISS_SSE2
+            return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(tag), bytes)));
+#else
+            uint32_t mask = 0;
+            for (size_t i = 0; i < width; i++) mask |= static_cast<uint32_t>(bytes[i] == tag) << i;
+            return mask;
+#endif
+        }
+
+        uint32_t match_empty() const { return match(EMPTY); }
+
+        uint32_t match_empty_or_deleted() const {
+#ifdef HASHTABLE_SWISS_SSE2
+            return static_cast<uint32_t>(_mm_movemask_epi8(bytes)); // sign bits
+#else
+            uint32_t mask = 0;
+            for (size_t i = 0; i < width; i++) mask |= static_cast<uint32_t>(bytes[i] < 0) << i;
+            return mask;
+#endif
+        }
+
+        // index of the lowest set bit of a non-zero mask
+        static size_t lowest_bit(uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+            return static_cast<size_t>(__builtin_ctz(mask));
+#else
+            size_t bit = 0;
+            while (!(mask & 1)) { mask >>= 1; bit++; }
+            return bit;
+#endif
+        }
+
+    private:
+#ifdef HASHTABLE_SWISS_SSE2
+        __m128i bytes;
+#else
+        int8_t bytes[width];
+#endif
+};
+
+template <class Key, class Hash=std::hash<Key>, class KeyEqual=std::equal_to<Key>>
+class HashTable {
+
+    private:
+        vector<int8_t> control; // one tag per slot
+        vector<Key> slots;
+        size_t _size;
+        size_t growth_left; // empty slots that may still be filled before the table is over 7/8 full
+
+        static size_t max_load(size_t capacity) { return capacity - capacity / 8; }
+
+        // the hash is mixed so identity hashes still spread over the groups and tags. the low 7 bits are the tag, the
+        // rest picks the home group
+        static size_t hash_of(const Key& value) { return PowerOfTwoSizing::mix(Hash{}(value)); }
+        static int8_t tag(size_t hash_value) { return static_cast<int8_t>(hash_value & 0x7F); }
+        size_t group_mask() const { return slots.size() / ControlGroup::width - 1; }
+
+        // slot holding value, or slots.size() if there isn't one. groups are visited with triangular probing, which
+        // reaches every group of a power of two table. a group with an empty slot ends the search: value would have
+        // been placed there.
+        size_t find_index(const Key& value, size_t hash_value) const {
+            size_t group = (hash_value >> 7) & group_mask();
+            for (size_t i = 1; ; group = (group + i++) & group_mask()) {
+                size_t base = group * ControlGroup::width;
+                ControlGroup g(&control[base]);
+                for (uint32_t mask = g.match(tag(hash_value)); mask; mask &= mask - 1) {
+                    size_t index = base + ControlGroup::lowest_bit(mask);
+                    if (KeyEqual{}(slots[index], value)) return index;
+                }
+                if (g.match_empty()) return slots.size();
+                if (i > group_mask()) return slots.size(); // every group visited
+            }
+        }
+
+        // first empty or deleted slot in value's probe sequence. there is always one since the table is never full
+        size_t find_insert_index(size_t hash_value) const {
+            size_t group = (hash_value >> 7) & group_mask();
+            for (size_t i = 1; ; group = (group + i++) & group_mask()) {
+                size_t base = group * ControlGroup::width;
+                uint32_t mask = ControlGroup(&control[base]).match_empty_or_deleted();
+                if (mask) return base + ControlGroup::lowest_bit(mask);
+            }
+        }
+
+        // rebuilds the table at capacity slots, dropping every deleted tag. values are moved, not copied
+        void rehash(size_t capacity) {
+            vector<int8_t> old_control(capacity, ControlGroup::EMPTY);
+            vector<Key> old_slots(capacity);
+            control.swap(old_control);
+            slots.swap(old_slots);
+            growth_left = max_load(capacity) - _size;
+
+            for (size_t index = 0; index < old_slots.size(); index++) {
+                if (old_control[index] >= 0) {
+                    size_t hash_value = hash_of(old_slots[index]);
+                    size_t target = find_insert_index(hash_value);
+                    slots[target] = std::move(old_slots[index]);
+                    control[target] = tag(hash_value);
+                }
+            }
+        }
+
+        template <class K>
+        bool insert_value(K&& value) {
+            size_t hash_value = hash_of(value);
+            if (find_index(value, hash_value) != slots.size()) return false;
+
+            size_t index = find_insert_index(hash_value);
+            if (control[index] == ControlGroup::EMPTY && growth_left == 0) {
+                // out of empty slots. if deleted tags are what filled the table, clearing them at the same size is enough
+                rehash(_size + 1 > max_load(slots.size()) / 2 ? slots.size() * 2 : slots.size());
+                index = find_insert_index(hash_value);
+            }
+
+            // perform insert
+            if (control[index] == ControlGroup::EMPTY) growth_left--;
+            slots[index] = std::forward<K>(value);
+            control[index] = tag(hash_value);
+            _size++;
+            return true;
+        }
+
+    public:
+        // constructors
+        HashTable() : HashTable(ControlGroup::width) {}
+        explicit HashTable(size_t size) : control{}, slots{}, _size{0}, growth_left{0} {
+            size_t capacity = PowerOfTwoSizing::valid_size(size < ControlGroup::width ? ControlGroup::width : size);
+            control.assign(capacity, ControlGroup::EMPTY);
+            slots.resize(capacity);
+            growth_left = max_load(capacity);
+        }
+
+        // capacity
+        bool is_empty() const { return _size == 0; }
+        size_t size() const { return _size; }
+        size_t table_size() const { return slots.size(); }
+
+        // modifiers
+        void make_empty() {
+            control.assign(control.size(), ControlGroup::EMPTY);
+            slots = vector<Key>(slots.size());
+            _size = 0;
+            growth_left = max_load(slots.size());
+        }
+
+        bool insert(const Key& value) { return insert_value(value); } // returns true on successful insert, false on failed insert
+        bool insert(Key&& value) { return insert_value(std::move(value)); }
+
+        size_t remove(const Key& value) { // returns 1 on successful removal, 0 on failed removal
+            size_t index = find_index(value, hash_of(value));
+            if (index == slots.size()) return 0;
+
+            // a group that still has an empty slot never stopped a probe, so the slot can go straight back to empty.
+            // otherwise some other key may have probed past this group and the slot has to stay marked deleted
+            size_t base = index - index % ControlGroup::width;
+            if (ControlGroup(&control[base]).match_empty()) {
+                control[index] = ControlGroup::EMPTY;
+                growth_left++;
+            } else {
+                control[index] = ControlGroup::DELETED;
+            }
+            _size--;
+
+            return 1;
+        }
+
+        // lookup
+        bool contains(const Key& value) const {
+            return find_index(value, hash_of(value)) != slots.size();
+        }
+
+        // visualization
+        void print_table(std::ostream& os = std::cout) const {
+            if (is_empty()) {
+                os << "<empty>" << endl;
+                return;
+            }
+
+            for (size_t index = 0; index < slots.size(); index++) {
+                if (control[index] >= 0)
+                    os << index << ": " << slots[index] << endl;
+            }
+        }
+};
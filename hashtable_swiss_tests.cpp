@@ -0,0 +1,190 @@
+#include "hashtable_swiss.h"
+#include <sstream>
+#include <string_view>
+#include <iostream>
+
+#define black   "\033[30m"
+#define red     "\033[31m"
+#define green   "\033[32m"
+#define yellow  "\033[33m"
+#define blue    "\033[34m"
+#define magenta "\033[35m"
+#define cyan    "\033[36m"
+#define white   "\033[37m"
+#define reset   "\033[m"
+
+#define to_be ==
+#define not_to_be !=
+#define is to_be
+#define is_not not_to_be
+
+#define expect(X) try {\
+  if (!(X)) {\
+    std::cout << red "  [fail]" reset " (" << __FILE__ << ":" << __FUNCTION__ << ":" << __LINE__ << ") " << red << "expected " << #X << "." << reset << std::endl;\
+  }\
+} catch(...) {\
+  std::cout << red "  [fail]" reset " (" << __FILE__ << ":" << __FUNCTION__ << ":" << __LINE__ << ") " << red << #X << " threw an unexpected exception." << reset << std::endl;\
+}
+
+#define assert(X) try {\
+  if (!(X)) {\
+    std::cout << red "  [fail]" reset " (" << __FILE__ << ":" << __FUNCTION__ << ":" << __LINE__ << ") " << red << "failed assertion that " << #X << "." << reset << std::endl;\
+    std::abort();\
+  }\
+} catch(...) {\
+  std::cout << red "  [fail]" reset " (" << __FILE__ << ":" << __FUNCTION__ << ":" << __LINE__ << ") " << red << #X << " assertion threw an unexpected exception." << reset << std::endl;\
+}
+
+#define expect_throw(X,E) {\
+  bool threw_expected_exception = false;\
+  try { X; }\
+  catch(const E& err) {\
+    threw_expected_exception = true;\
+  } catch(...) {\
+    std::cout << blue << "  [help] " << #X << " threw an incorrect exception." << reset << std::endl;\
+  }\
+  if (!threw_expected_exception) {\
+    std::cout << red <<"  [fail]" << reset << " (" << __FILE__ << ":" << __FUNCTION__ << ":" << __LINE__ << ") " << red << "expected " << #X << " to throw " << #E <<"." << reset <<std::endl;\
+  }\
+}
+
+#define expect_no_throw(X) {\
+  try { X; }\
+  catch(...) {\
+    std::cout << red << "  [fail]" << red << " (" << __FILE__ << ":" << __FUNCTION__ << ":" << __LINE__ << ") " << red << "expected " << #X << " not to throw an excpetion." << reset << std::endl;\
+  }\
+}
+
+// hash which sends every key to the same group with the same tag, so every operation has to probe
+struct ConstantHash {
+    size_t operator()(int) const { return 0; }
+};
+
+int main() {
+    // is_empty() / make_empty
+    {
+        HashTable<int> intTable;
+        expect(intTable.is_empty() to_be true);
+        intTable.insert(1);
+        expect(intTable.is_empty() to_be false);
+        intTable.make_empty();
+        expect(intTable.is_empty() to_be true);
+        expect(intTable.contains(1) to_be false);
+        expect(intTable.table_size() to_be 16);
+    }
+
+    // constructors
+    {
+        HashTable<int> intTable;
+        expect(intTable.size() to_be 0);
+        expect(intTable.table_size() to_be 16);
+        expect(intTable.contains(0) to_be false);
+
+        HashTable<double> doubleTable(100);
+        expect(doubleTable.table_size() to_be 128);
+        expect(doubleTable.is_empty() to_be true);
+
+        HashTable<char> charTable(3); // at least one full group
+        expect(charTable.table_size() to_be 16);
+    }
+
+    // insert / contains
+    {
+        HashTable<int> intTable;
+        expect(intTable.insert(1) to_be true);
+        expect(intTable.size() to_be 1);
+        expect(intTable.contains(1) to_be true);
+        expect(intTable.contains(2) to_be false);
+        expect(intTable.insert(2) to_be true);
+        expect(intTable.insert(1) to_be false); // duplicate
+        expect(intTable.size() to_be 2);
+
+        HashTable<std::string> stringTable;
+        std::string moved = "moved";
+        expect(stringTable.insert(std::move(moved)) to_be true);
+        expect(stringTable.insert("copied") to_be true);
+        expect(stringTable.contains("moved") to_be true);
+        expect(stringTable.contains("copied") to_be true);
+        expect(stringTable.contains("neither") to_be false);
+    }
+
+    // remove
+    {
+        HashTable<int> intTable;
+        for (int i = 0; i < 10; i++) intTable.insert(i);
+        expect(intTable.remove(3) to_be 1);
+        expect(intTable.remove(3) to_be 0);
+        expect(intTable.contains(3) to_be false);
+        expect(intTable.size() to_be 9);
+        expect(intTable.remove(42) to_be 0);
+        expect(intTable.insert(3) to_be true);
+        expect(intTable.contains(3) to_be true);
+        expect(intTable.size() to_be 10);
+    }
+
+    // insert which cause a rehash
+    {
+        HashTable<int> intTable;
+        for (int i = 0; i < 14; i++) intTable.insert(i); // 7/8 of 16
+        expect(intTable.table_size() to_be 16);
+        intTable.insert(14);
+        expect(intTable.table_size() to_be 32);
+        expect(intTable.size() to_be 15);
+        for (int i = 0; i < 15; i++) expect(intTable.contains(i) to_be true);
+
+        HashTable<int> largeTable;
+        for (int i = 0; i < 100000; i++) largeTable.insert(i * 7);
+        expect(largeTable.size() to_be 100000);
+        expect(largeTable.table_size() to_be 131072);
+        for (int i = 0; i < 100000; i++) assert(largeTable.contains(i * 7) to_be true);
+        for (int i = 0; i < 100000; i++) assert(largeTable.contains(i * 7 + 1) to_be false);
+    }
+
+    // collisions across groups
+    {
+        HashTable<int, ConstantHash> intTable;
+        for (int i = 0; i < 100; i++) expect(intTable.insert(i) to_be true);
+        expect(intTable.size() to_be 100);
+        for (int i = 0; i < 100; i++) assert(intTable.contains(i) to_be true);
+        expect(intTable.contains(100) to_be false);
+        for (int i = 0; i < 100; i += 2) expect(intTable.remove(i) to_be 1);
+        for (int i = 0; i < 100; i++) assert(intTable.contains(i) to_be (i % 2 == 1));
+        for (int i = 0; i < 100; i += 2) expect(intTable.insert(i) to_be true);
+        for (int i = 0; i < 100; i++) assert(intTable.contains(i) to_be true);
+    }
+
+    // insert/remove churn keeps the table at a constant size
+    {
+        HashTable<int> intTable;
+        for (int i = 0; i < 10000; i++) {
+            expect(intTable.insert(i) to_be true);
+            if (i >= 8) expect(intTable.remove(i - 8) to_be 1);
+        }
+        expect(intTable.table_size() to_be 16);
+        expect(intTable.size() to_be 8);
+        for (int i = 0; i < 10000; i++) assert(intTable.contains(i) to_be (i >= 9992));
+
+        HashTable<int, ConstantHash> collidingTable;
+        for (int i = 0; i < 1000; i++) {
+            expect(collidingTable.insert(i) to_be true);
+            if (i >= 20) expect(collidingTable.remove(i - 20) to_be 1);
+        }
+        expect(collidingTable.table_size() to_be 32);
+        for (int i = 0; i < 1000; i++) assert(collidingTable.contains(i) to_be (i >= 980));
+    }
+
+    // print table
+    {
+        HashTable<int> intTable;
+        std::stringstream emptyss;
+        intTable.print_table(emptyss);
+        expect(emptyss.str() to_be "<empty>\n");
+
+        intTable.insert(2);
+        std::stringstream ss;
+        intTable.print_table(ss);
+        expect(ss.str().find(": 2\n") not_to_be std::string::npos);
+    }
+
+    return 0;
+}